@@ -0,0 +1,92 @@
+#include "VHLog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+// Checks that logging allocates nothing once the logger is warmed up: short plain text
+// messages and deferred messages, both on the calling thread and on the logger thread.
+// Every operator new in the process is counted while batches of messages go to a
+// null sink, for at least one change of the second so the cached timestamp is rebuilt
+// as well. Exits with 1 when anything was allocated.
+
+static std::atomic<long> g_allocations{0};
+
+void* operator new(std::size_t size) {
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// A null sink that counts lines, so the check knows when the logger thread is done.
+class CountingNullSink : public VHNullSink {
+public:
+    void write(std::span<const VHLogRecord> records) override {
+        lines_.fetch_add(records.size(), std::memory_order_release);
+    }
+
+    std::size_t lines() const { return lines_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<std::size_t> lines_{0};
+};
+
+static const int messages = 200000;
+
+// Logs messages plain text lines and as many deferred ones, then waits for the sink.
+void log_round(VHLogger& logger, const CountingNullSink& sink, const std::string& text) {
+
+    std::size_t expected = sink.lines() + 2 * messages;
+    for (int i = 0; i < messages; ++i) {
+        logger.log(VHLogLevel::INFOLV, text);
+        logger.log(VHLogLevel::INFOLV, "value {} and {}", i, 2.5);
+    }
+    while (sink.lines() < expected) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+int main() {
+
+    long allocations = 0;
+    long rounds = 0;
+    {
+        VHLogger logger(false, 256);
+        auto sink = std::make_shared<CountingNullSink>();
+        logger.addSink(sink);
+        // Short enough to fit the slot inline (VHLogPayload::INLINE_CAPACITY).
+        std::string text(120, 'x');
+
+        // The first round grows the batch buffers to their working size.
+        log_round(logger, *sink, text);
+        auto start = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+        long before = g_allocations.load(std::memory_order_relaxed);
+        do {
+            log_round(logger, *sink, text);
+            ++rounds;
+        } while (std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()) == start);
+        allocations = g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    std::cout << "Allocations for " << 2 * messages * rounds << " messages: " << allocations << std::endl;
+    if (allocations != 0) {
+        std::cout << "Logging is expected not to allocate once warmed up" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -20,11 +20,21 @@ struct BenchmarkResult {
     std::string sink_config;
 };
 
+// What each benchmark thread logs: a message built with std::to_string, the same
+// message through deferred formatting, or the number as a structured field.
+enum class BenchMessage {
+    Text,
+    Deferred,
+    Structured
+};
+
 std::vector<BenchmarkResult> g_results;
 std::ofstream g_results_file;
 
-void bench(int howmany, VHLogger& logger, const std::string& test_name, size_t threads, const std::string& sink_config);
-void bench_mt(int howmany, VHLogger& logger, size_t thread_count, const std::string& test_name, const std::string& sink_config);
+void bench(int howmany, VHLogger& logger, const std::string& test_name, size_t threads, const std::string& sink_config,
+           BenchMessage message = BenchMessage::Text);
+void bench_mt(int howmany, VHLogger& logger, size_t thread_count, const std::string& test_name, const std::string& sink_config,
+              BenchMessage message = BenchMessage::Text);
 
 static const size_t file_size = 30 * 1024 * 1024;
 static const int max_threads = 1000;
@@ -122,6 +132,51 @@ void bench_threaded_logging(size_t threads, int iters) {
         bench_mt(iters, basic_mt, threads, "Basic File Sink", "File only");
     }
 
+    {
+        VHLogger uring_mt(false, 100);
+        auto uringSink = std::make_shared<VHUringFileSink>("logs/uring_mt.log", file_size);
+        uring_mt.addSink(uringSink);
+        std::cout << "\n[io_uring File Sink" << (uringSink->usingIoUring() ? "" : " - fallback") << "]\n";
+        bench_mt(iters, uring_mt, threads, "io_uring File Sink", "File (io_uring)");
+    }
+
+    {
+        VHLogger mapped_mt(false, 100);
+        mapped_mt.addSink(std::make_shared<VHMappedFileSink>("logs/mapped_mt.log", file_size));
+        std::cout << "\n[Memory-mapped File Sink]\n";
+        bench_mt(iters, mapped_mt, threads, "Mapped File Sink", "File (mmap)");
+    }
+
+    {
+        VHLogger deferred_mt(false, 100);
+        deferred_mt.addFileSink("logs/deferred_mt.log", file_size);
+        std::cout << "\n[Basic File Sink, deferred formatting]\n";
+        bench_mt(iters, deferred_mt, threads, "Deferred File Sink", "File only", BenchMessage::Deferred);
+    }
+
+    {
+        VHLogger binary_mt(false, 100);
+        binary_mt.addSink(std::make_shared<VHBinaryFileSink>("logs/binary_mt", file_size));
+        std::cout << "\n[Binary File Sink, deferred formatting]\n";
+        bench_mt(iters, binary_mt, threads, "Binary File Sink", "File (binary)", BenchMessage::Deferred);
+    }
+
+    {
+        VHLogger json_mt(false, 100);
+        auto jsonSink = std::make_shared<VHFileSink>("logs/json_mt.log", file_size);
+        jsonSink->setLayout(VHLogLayout::Json);
+        json_mt.addSink(jsonSink);
+        std::cout << "\n[JSON File Sink, structured fields]\n";
+        bench_mt(iters, json_mt, threads, "JSON File Sink", "File (JSON)", BenchMessage::Structured);
+    }
+
+    {
+        VHLogger gzip_mt(false, 100);
+        gzip_mt.addSink(std::make_shared<VHGzipFileSink>("logs/gzip_mt", file_size));
+        std::cout << "\n[Compressed File Sink]\n";
+        bench_mt(iters, gzip_mt, threads, "Gzip File Sink", "File (gzip)");
+    }
+
     {
         VHLogger rotating_mt(false, 100);
         rotating_mt.addFileSink("logs/rotating_mt", file_size);
@@ -187,6 +242,67 @@ void bench_single_threaded(int iters) {
         bench(iters, basic_st, "Basic File (ST)", 1, "File only");
     }
 
+    {
+        VHLogger uring_st(false, 100);
+        auto uringSink = std::make_shared<VHUringFileSink>("logs/uring_st.log", file_size);
+        uring_st.addSink(uringSink);
+        std::cout << "\n[io_uring File Sink" << (uringSink->usingIoUring() ? "" : " - fallback") << "]\n";
+        bench(iters, uring_st, "io_uring File (ST)", 1, "File (io_uring)");
+    }
+
+    {
+        VHLogger mapped_st(false, 100);
+        mapped_st.addSink(std::make_shared<VHMappedFileSink>("logs/mapped_st.log", file_size));
+        std::cout << "\n[Memory-mapped File Sink]\n";
+        bench(iters, mapped_st, "Mapped File (ST)", 1, "File (mmap)");
+    }
+
+    {
+        VHLogger deferred_st(false, 100);
+        deferred_st.addFileSink("logs/deferred_st.log", file_size);
+        std::cout << "\n[Basic File Sink, deferred formatting]\n";
+        bench(iters, deferred_st, "Deferred File (ST)", 1, "File only", BenchMessage::Deferred);
+    }
+
+    {
+        VHLogger binary_st(false, 100);
+        binary_st.addSink(std::make_shared<VHBinaryFileSink>("logs/binary_st", file_size));
+        std::cout << "\n[Binary File Sink, deferred formatting]\n";
+        bench(iters, binary_st, "Binary File (ST)", 1, "File (binary)", BenchMessage::Deferred);
+    }
+
+    {
+        VHLogger structured_st(false, 100);
+        structured_st.addFileSink("logs/structured_st.log", file_size);
+        std::cout << "\n[Basic File Sink, structured fields]\n";
+        bench(iters, structured_st, "Structured File (ST)", 1, "File only", BenchMessage::Structured);
+    }
+
+    {
+        VHLogger json_st(false, 100);
+        auto jsonSink = std::make_shared<VHFileSink>("logs/json_st.log", file_size);
+        jsonSink->setLayout(VHLogLayout::Json);
+        json_st.addSink(jsonSink);
+        std::cout << "\n[JSON File Sink, structured fields]\n";
+        bench(iters, json_st, "JSON File (ST)", 1, "File (JSON)", BenchMessage::Structured);
+    }
+
+    {
+        VHLogger logfmt_st(false, 100);
+        auto logfmtSink = std::make_shared<VHFileSink>("logs/logfmt_st.log", file_size);
+        logfmtSink->setLayout(VHLogLayout::Logfmt);
+        logfmt_st.addSink(logfmtSink);
+        std::cout << "\n[logfmt File Sink, structured fields]\n";
+        bench(iters, logfmt_st, "logfmt File (ST)", 1, "File (logfmt)", BenchMessage::Structured);
+    }
+
+    {
+        VHLogger gzip_st(false, 100);
+        gzip_st.addSink(std::make_shared<VHGzipFileSink>("logs/gzip_st", file_size));
+        std::cout << "\n[Compressed File Sink]\n";
+        bench(iters, gzip_st, "Gzip File (ST)", 1, "File (gzip)");
+    }
+
     {
         VHLogger console_st(false, 100);
         console_st.addConsoleSink();
@@ -267,7 +383,7 @@ int main(int argc, char *argv[]) {
 }
 
 void bench(int howmany, VHLogger& logger, const std::string& test_name, 
-           size_t threads, const std::string& sink_config) {
+           size_t threads, const std::string& sink_config, BenchMessage message) {
     using namespace std::chrono;
     
     VHLogger result_logger(false, 10);
@@ -276,7 +392,13 @@ void bench(int howmany, VHLogger& logger, const std::string& test_name,
     auto start = high_resolution_clock::now();
     
     for (int i = 0; i < howmany; ++i) {
-        logger.log(VHLogLevel::INFOLV, "Hello logger: msg number " + std::to_string(i));
+        if (message == BenchMessage::Deferred) {
+            logger.log(VHLogLevel::INFOLV, "Hello logger: msg number {}", i);
+        } else if (message == BenchMessage::Structured) {
+            logger.log(VHLogLevel::INFOLV, "Hello logger", {{"msg_number", i}});
+        } else {
+            logger.log(VHLogLevel::INFOLV, "Hello logger: msg number " + std::to_string(i));
+        }
     }
     
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
@@ -305,7 +427,7 @@ void bench(int howmany, VHLogger& logger, const std::string& test_name,
 }
 
 void bench_mt(int howmany, VHLogger& logger, size_t thread_count, 
-              const std::string& test_name, const std::string& sink_config) {
+              const std::string& test_name, const std::string& sink_config, BenchMessage message) {
     using namespace std::chrono;
     
     std::vector<std::thread> threads;
@@ -314,10 +436,16 @@ void bench_mt(int howmany, VHLogger& logger, size_t thread_count,
     auto start = high_resolution_clock::now();
     
     for (size_t t = 0; t < thread_count; ++t) {
-        threads.emplace_back([&logger, howmany, thread_count, t]() {
+        threads.emplace_back([&logger, howmany, thread_count, t, message]() {
             int per_thread = howmany / static_cast<int>(thread_count);
             for (int j = 0; j < per_thread; j++) {
-                logger.log(VHLogLevel::INFOLV, "Hello logger: msg number " + std::to_string(j));
+                if (message == BenchMessage::Deferred) {
+                    logger.log(VHLogLevel::INFOLV, "Hello logger: msg number {}", j);
+                } else if (message == BenchMessage::Structured) {
+                    logger.log(VHLogLevel::INFOLV, "Hello logger", {{"msg_number", j}});
+                } else {
+                    logger.log(VHLogLevel::INFOLV, "Hello logger: msg number " + std::to_string(j));
+                }
             }
         });
     }
@@ -1,32 +1,136 @@
 #pragma once
+#include <chrono>
 #include <cstddef>
-#include <fstream>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <format>
 #include <mutex>
 #include <ctime>
 #include <memory>
-#include <deque>
 #include <thread>
-#include <set>
+#include <atomic>
+#include <vector>
 #include <condition_variable>
 #include <utility>
+#include <initializer_list>
 #include <type_traits>
 
-#ifdef USE_ASIO
-#include "asio.hpp"
+#include "VHLogBinaryFileSink.h"
+#include "VHLogClock.h"
+#include "VHLogFields.h"
+#include "VHLogFileSink.h"
+#include "VHLogFormat.h"
+#include "VHLogGzipFileSink.h"
+#include "VHLogMappedFileSink.h"
+#include "VHLogPattern.h"
+#include "VHLogPayload.h"
+#include "VHLogRecord.h"
+#include "VHLogRingBuffer.h"
+#include "VHLogSink.h"
+#include "VHLogTCPSink.h"
+#include "VHLogUringFileSink.h"
+
+// Compile-time minimum level. Calls made through the VHLOG_* macros below this level
+// are compiled out together with their argument expressions.
+#define VHLOG_LEVEL_DEBUG 0
+#define VHLOG_LEVEL_INFO 1
+#define VHLOG_LEVEL_WARNING 2
+#define VHLOG_LEVEL_ERROR 3
+#define VHLOG_LEVEL_FATAL 4
+#define VHLOG_LEVEL_OFF 5
+
+#ifndef VHLOG_ACTIVE_LEVEL
+#define VHLOG_ACTIVE_LEVEL VHLOG_LEVEL_DEBUG
 #endif
 
-enum class VHLogLevel {
-    DEBUGLV,
-    INFOLV,
-    WARNINGLV,
-    ERRORLV,
-    FATALLV
+constexpr bool vhlogLevelCompiled(VHLogLevel level) {
+    return static_cast<int>(level) >= VHLOG_ACTIVE_LEVEL;
+}
+
+enum class VHLogTimestampPrecision {
+    Seconds,
+    Milliseconds,
+    Microseconds,
+    Nanoseconds
+};
+
+// What log() does when the queue is full. DropBelowLevel drops messages under the
+// given level and blocks for the rest. Per-thread buffers treat DropOldest as
+// DropNewest, since only the logger thread may consume from them. Once the logger
+// shuts down nothing frees room anymore, blocking calls then drop the message.
+enum class VHLogOverflowPolicy {
+    Block,
+    DropNewest,
+    DropOldest,
+    DropBelowLevel
+};
+
+struct VHLogMessage {
+    VHLogLevel level = VHLogLevel::INFOLV;
+    // Trailing bytes of message that hold encoded fields, see VHLogFields.h.
+    std::uint32_t fieldsSize = 0;
+    // See VHLogRecord::thread.
+    std::uint32_t thread = 0;
+    // Plain text, or the encoded arguments when formatter is set.
+    VHLogPayload message;
+    VHLogFormatFn formatter = nullptr;
+    std::string_view format;
+    // Type tags of the encoded arguments, see vhlogArgTypes().
+    const char* argTypes = nullptr;
+    // VHLogClock ticks taken at the call site.
+    std::uint64_t timestamp = 0;
+};
+
+// Staging buffer owned by one producer thread. The thread flags producerExited on exit,
+// the worker then drains what is left and drops the buffer. consumerClosed is set when
+// the owning logger shuts down, so the thread can forget about it.
+struct VHLogThreadBuffer {
+    explicit VHLogThreadBuffer(std::size_t capacity) : queue(capacity) {}
+    VHLogSpscBuffer<VHLogMessage> queue;
+    std::atomic<bool> producerExited{false};
+    std::atomic<bool> consumerClosed{false};
+};
+
+class VHLogger;
+
+// Queue storage handed out by VHLogger::reserve(): write the message into data() and
+// pass the reservation to commit(). One that is dropped uncommitted is queued empty
+// and skipped. Messages queued after it wait for the commit, and the thread holding
+// it must not log before committing.
+class VHLogReservation {
+public:
+    VHLogReservation() = default;
+    VHLogReservation(VHLogReservation&& other) noexcept;
+    VHLogReservation& operator=(VHLogReservation&& other) noexcept;
+    ~VHLogReservation();
+
+    // False when the level is filtered out or the message was dropped.
+    explicit operator bool() const { return slot_ != nullptr; }
+    char* data() { return slot_->message.data(); }
+    std::size_t size() const { return slot_->message.size(); }
+    // For callers that wrote less than they reserved.
+    void truncate(std::size_t size) { slot_->message.truncate(size); }
+
+private:
+    friend class VHLogger;
+
+    void release();
+
+    VHLogger* logger_ = nullptr;
+    VHLogMessage* slot_ = nullptr;
+    // The per-thread buffer the slot belongs to, null for the shared queue.
+    VHLogThreadBuffer* buffer_ = nullptr;
+    std::size_t position_ = 0;
 };
 
 class VHLogger {
 public:
-    explicit VHLogger(bool debugEnvironment = true, std::size_t batchSize = 1);
+    static constexpr std::size_t DEFAULT_QUEUE_CAPACITY = 65536;
+    static constexpr std::size_t DEFAULT_THREAD_BUFFER_CAPACITY = 4096;
+
+    explicit VHLogger(bool debugEnvironment = true, std::size_t batchSize = 1,
+                      std::size_t queueCapacity = DEFAULT_QUEUE_CAPACITY);
     void shutdown();
     virtual ~VHLogger();
 
@@ -35,67 +139,223 @@ public:
         return nfLogger;
     }
 
-private:
-    enum class VHLogSinkType {
-        ConsoleSink,
-        FileSink,
-        NullSink,
-        TCPSink
-    };
+    // Registers any VHLogSink. Sinks can be added while logging and any number of them,
+    // of any type, may be active at once.
+    void addSink(std::shared_ptr<VHLogSink> sink);
 
-public:
     void addConsoleSink();
-    void addFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024);
+    void addFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024,
+                     std::size_t bufferSize = VHFileSink::DEFAULT_BUFFER_SIZE);
     void addNullSink();
     void addTCPSink(const std::string& hostIpAddress, unsigned int hostPort);
 
-    void log(VHLogLevel level, const std::string& message);
+    // Opt-in: each producer thread gets its own SPSC staging buffer instead of sharing
+    // the MPSC queue. With orderByTimestamp the worker sorts every drained batch by the
+    // call-site timestamp, otherwise buffers are written round-robin.
+    void enablePerThreadBuffers(bool orderByTimestamp = false,
+                                std::size_t perThreadCapacity = DEFAULT_THREAD_BUFFER_CAPACITY);
+
+    void setTimestampPrecision(VHLogTimestampPrecision precision);
+
+    // Dropped messages are counted and the logger thread writes a
+    // "N messages dropped" warning to the sinks about once a second.
+    void setOverflowPolicy(VHLogOverflowPolicy policy, VHLogLevel dropBelowLevel = VHLogLevel::WARNINGLV);
+    std::uint64_t droppedMessages() const { return droppedMessages_.load(std::memory_order_relaxed); }
+
+    // Runtime minimum level, can be changed while other threads are logging. The
+    // constructor's debugEnvironment flag sets it to DEBUGLV or INFOLV.
+    void setMinimumLevel(VHLogLevel level) { minimumLevel_.store(level, std::memory_order_relaxed); }
+    VHLogLevel minimumLevel() const { return minimumLevel_.load(std::memory_order_relaxed); }
+    bool shouldLog(VHLogLevel level) const {
+        return vhlogLevelCompiled(level) && level >= minimumLevel_.load(std::memory_order_relaxed);
+    }
+
+    // Compile-time level variant of log(). Prefer the VHLOG_* macros, which also skip
+    // evaluating the arguments.
+    template <VHLogLevel Level>
+    void log(const std::string& message) {
+
+        if constexpr (vhlogLevelCompiled(Level)) {
+            log(Level, message);
+        }
+    }
+
+    template <VHLogLevel Level, typename... Args>
+        requires (sizeof...(Args) > 0)
+    void log(std::format_string<Args...> format, Args&&... args) {
+
+        if constexpr (vhlogLevelCompiled(Level)) {
+            log(Level, format, std::forward<Args>(args)...);
+        }
+    }
+
+    // Each copies the text once, straight into the queue slot; an rvalue string
+    // too long to be stored inline is moved instead.
+    void log(VHLogLevel level, std::string_view message);
+    void log(VHLogLevel level, std::string&& message);
+    void log(VHLogLevel level, const char* message) { log(level, std::string_view(message)); }
+    // Structured: the fields are rendered per sink layout, as key=value pairs on text
+    // lines and as members of the JSON object.
+    void log(VHLogLevel level, std::string_view message, std::initializer_list<VHLogField> fields);
+
+    // For callers formatting into the queue themselves, so the bytes are written
+    // exactly once:
+    //   if (auto slot = logger.reserve(VHLogLevel::INFOLV, size)) {
+    //       ... write up to size bytes to slot.data() ...
+    //       logger.commit(slot);
+    //   }
+    // The overflow policy applies as in log(). See VHLogReservation.
+    VHLogReservation reserve(VHLogLevel level, std::size_t size);
+    void commit(VHLogReservation& reservation);
+
+    // Deferred formatting: the arguments are copied as bytes and std::format runs on the
+    // logger thread. Arguments that cannot be copied that way are formatted here.
+    template <typename... Args>
+    void log(VHLogLevel level, std::format_string<Args...> format, Args&&... args) {
+
+        if (!shouldLog(level)) {
+            return;
+        }
+        if constexpr ((VHLogDeferrableArg<std::remove_cvref_t<Args>> && ...)) {
+            VHLogReservation slot = reserve(level, vhlogEncodedSize<std::remove_cvref_t<Args>...>(args...));
+            if (slot) {
+                vhlogEncodeArgs<std::remove_cvref_t<Args>...>(slot.data(), args...);
+                slot.slot_->format = format.get();
+                slot.slot_->formatter = &vhlogFormatDeferred<std::remove_cvref_t<Args>...>;
+                slot.slot_->argTypes = vhlogArgTypes<std::remove_cvref_t<Args>...>();
+                commit(slot);
+            }
+        }
+        else {
+            log(level, std::format(format, std::forward<Args>(args)...));
+        }
+    }
 
 private:
+    friend class VHLogReservation;
+
+    void enqueue(VHLogMessage&& entry);
+    template <typename TryFn>
+    bool waitForSlot(VHLogLevel level, VHLogThreadBuffer* buffer, TryFn&& tryFn);
+    void notifyWorkerIfParked();
+    void publish(VHLogReservation& reservation);
+    void writeToDestination(const std::vector<VHLogMessage>& batch);
     void writeToDestination(VHLogLevel level, const std::string& message);
-    void appendNewSink(VHLogSinkType newSink) { sinkTypes_.insert(newSink); }
-    bool shouldRotate(std::size_t messageSize);
-    void rotateFileSink();
+    void appendRecord(const VHLogMessage& entry, bool composeLine, bool formatMessage);
+    struct LayoutBatch;
+    void renderLayout(VHLogLayout layout, LayoutBatch& target, const VHLogPattern* pattern = nullptr);
+    const VHLogTimeFields& localTimeFields(std::chrono::system_clock::time_point time);
+    void appendTimestamp(std::string& out, std::chrono::system_clock::time_point now,
+                         VHLogLayout layout = VHLogLayout::Text);
+    void flushSinks();
 
+    // Guards sinks_. The worker writes through its own snapshot, refreshed when
+    // sinksVersion_ moves, so registering a sink never stalls the hot loop.
     std::mutex mutex_;
-    std::mutex fileMutex_;
-    std::ofstream file_;
-    std::size_t unflushedBytes_;
+    std::vector<std::shared_ptr<VHLogSink>> sinks_;
+    std::atomic<std::uint64_t> sinksVersion_{0};
+    std::vector<std::shared_ptr<VHLogSink>> workerSinks_;
+    std::uint64_t workerSinksVersion_ = 0;
+
     std::thread loggerThread_;
     void loggerWorker();
-    bool workerRunning_;
+    void notifyWorker();
+    void collectBatch(std::vector<VHLogMessage>& batch);
+    bool hasPendingMessages();
+    void reportDroppedMessages();
+    VHLogThreadBuffer& localThreadBuffer();
+    std::atomic<bool> workerRunning_;
     std::size_t batchSize_;
 
-    std::deque<std::pair<VHLogLevel, std::string>> logMessageQueue_;
-    bool debugEnvironment_;
+    VHLogRingBuffer<VHLogMessage> logMessageQueue_;
+    std::atomic<VHLogLevel> minimumLevel_;
+    // Only used to park the worker when the queue runs dry, producers never lock it
+    // unless workerParked_ is set.
     std::mutex queueMutex_;
     std::condition_variable condVar_;
-    std::string basePathAndName_;
-    std::size_t maxSize_;
-    std::size_t currentSize_;
-    std::string currentDate_;
-    std::set<VHLogSinkType> sinkTypes_;
-    static constexpr std::size_t FLUSH_THRESHOLD = 4096;
+    std::atomic<bool> workerParked_{false};
+    static constexpr int WORKER_SPIN_ITERATIONS = 64;
+
+    std::atomic<VHLogOverflowPolicy> overflowPolicy_{VHLogOverflowPolicy::Block};
+    std::atomic<VHLogLevel> dropBelowLevel_{VHLogLevel::WARNINGLV};
+    std::atomic<std::uint64_t> droppedMessages_{0};
+    std::uint64_t reportedDroppedMessages_ = 0;
+
+    // Per-thread staging buffers. threadBuffersMutex_ is only taken when a thread
+    // registers or the worker retires a buffer; the worker works on its own snapshot
+    // and refreshes it when threadBuffersVersion_ moves.
+    const std::uint64_t loggerId_;
+    std::atomic<bool> perThreadBuffers_{false};
+    std::atomic<bool> orderByTimestamp_{false};
+    std::atomic<std::size_t> perThreadCapacity_{DEFAULT_THREAD_BUFFER_CAPACITY};
+    std::mutex threadBuffersMutex_;
+    std::vector<std::shared_ptr<VHLogThreadBuffer>> threadBuffers_;
+    std::atomic<std::uint64_t> threadBuffersVersion_{0};
+    std::vector<std::shared_ptr<VHLogThreadBuffer>> workerThreadBuffers_;
+    std::uint64_t workerThreadBuffersVersion_ = 0;
+    std::size_t nextThreadBuffer_ = 0;
+
+    // Timestamp caches per layout, only touched by the logger thread. The time zone
+    // lookup and date formatting run once per second, sub-second digits are appended
+    // by hand between prefix and suffix.
+    struct TimestampCache {
+        static constexpr std::size_t CAPACITY = 48;
+        std::chrono::sys_seconds second{};
+        std::string prefix;
+        std::string suffix;
+    };
+    const std::chrono::time_zone* timeZone_;
+    VHLogClock clock_;
+    std::atomic<VHLogTimestampPrecision> timestampPrecision_{VHLogTimestampPrecision::Seconds};
+    TimestampCache textTimestamp_;
+    // ISO 8601, shared by the Json and Logfmt layouts.
+    TimestampCache isoTimestamp_;
+    // Broken-down time for patterns, the date part is refreshed once a second.
+    std::chrono::sys_seconds timeFieldsSecond_{};
+    VHLogTimeFields timeFields_;
+
+    // Batch being handed to the sinks: every line is composed into batchText_ and
+    // batchRecords_ holds views into it. Every other layout in use renders the lines
+    // once more into its LayoutBatch, whose records differ only in line. All are reused
+    // across batches, the text buffers only while no sink kept a reference.
+    struct RecordOffsets {
+        std::size_t lineStart;
+        std::size_t messageStart;
+        std::size_t messageEnd;
+        std::size_t lineEnd;
+    };
+    std::shared_ptr<std::string> batchText_;
+    std::vector<RecordOffsets> batchOffsets_;
+    std::vector<VHLogRecord> batchRecords_;
+    struct LayoutBatch {
+        std::shared_ptr<std::string> text;
+        std::vector<std::size_t> offsets;
+        std::vector<VHLogRecord> records;
+    };
+    LayoutBatch jsonBatch_;
+    LayoutBatch logfmtBatch_;
+    // One per distinct pattern text among the sinks, refreshed with workerSinks_.
+    // Rendered on demand, at most once per batch.
+    struct PatternBatch {
+        std::shared_ptr<const VHLogPattern> pattern;
+        LayoutBatch batch;
+        bool rendered = false;
+    };
+    std::vector<PatternBatch> patternBatches_;
     bool vhlogShutdown_;
-#ifdef USE_ASIO 
-    // TCPSink with asio
-    asio::io_context ioContext_;
-    std::unique_ptr<asio::steady_timer> reconnectTimer_;
-    std::string hostIpAddress_;
-    unsigned int hostPort_;
-    std::string readBuffer_;
-    void connectTCPSink();
-    void startReadingForDisconnects();
-    void scheduleReconnectTCPSink();
-    std::atomic<bool> socketConnected_;
-    std::atomic<bool> shutdownSocket_{false};
-    asio::ip::tcp::socket socket_;
-    std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> workGuard_;
-    std::thread ioThread_;
-    mutable std::mutex socketMutex_;
-    std::deque<std::string> tcpMessageQueue_;
-    bool tcpIsSending_;
-    void sendNextTCPMessage();
-#endif
 };
 
+#define VHLOG_LOG(logger, level, ...)                          \
+    do {                                                       \
+        if constexpr (vhlogLevelCompiled(level)) {             \
+            if ((logger).shouldLog(level)) {                   \
+                (logger).log(level, __VA_ARGS__);              \
+            }                                                  \
+        }                                                      \
+    } while (0)
+
+#define VHLOG_DEBUG(logger, ...) VHLOG_LOG(logger, VHLogLevel::DEBUGLV, __VA_ARGS__)
+#define VHLOG_INFO(logger, ...) VHLOG_LOG(logger, VHLogLevel::INFOLV, __VA_ARGS__)
+#define VHLOG_WARNING(logger, ...) VHLOG_LOG(logger, VHLogLevel::WARNINGLV, __VA_ARGS__)
+#define VHLOG_ERROR(logger, ...) VHLOG_LOG(logger, VHLogLevel::ERRORLV, __VA_ARGS__)
+#define VHLOG_FATAL(logger, ...) VHLOG_LOG(logger, VHLogLevel::FATALLV, __VA_ARGS__)
@@ -0,0 +1,56 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What happens to the files a VHFileSink has finished with. Zero disables a limit.
+struct VHLogArchivePolicy {
+    // gzip closed files to {name}.gz (needs a USE_ZLIB build). Ignored for sinks that
+    // write .gz files themselves, such as VHGzipFileSink.
+    bool compress = true;
+    // Keep at most this many files of the sink, the active one included.
+    std::size_t maxFiles = 0;
+    // Keep the sink's files under this many bytes in total, the active one included.
+    std::uint64_t maxTotalSize = 0;
+};
+
+// Low priority thread compressing closed log files and deleting the oldest ones. It
+// streams through fixed 64KB buffers and never touches the file the sink is writing.
+// Files left over by earlier runs are picked up when it starts; on destruction it
+// finishes the file in progress and leaves the rest to the next run.
+class VHLogArchiver {
+public:
+    VHLogArchiver(const std::string& basePathAndName, const std::string& extension,
+                  const VHLogArchivePolicy& policy, const std::string& activeFile);
+    ~VHLogArchiver();
+
+    VHLogArchiver(const VHLogArchiver&) = delete;
+    VHLogArchiver& operator=(const VHLogArchiver&) = delete;
+
+    // Both are called by the sink on the logger thread and only take a short lock.
+    void setActiveFile(const std::string& fileName);
+    void fileClosed(const std::string& fileName);
+
+private:
+    void run();
+    bool compressFile(const std::string& fileName);
+    void enforceRetention();
+    std::vector<std::string> sinkFiles() const;
+    bool isActive(const std::string& fileName);
+
+    std::string basePathAndName_;
+    std::string extension_;
+    VHLogArchivePolicy policy_;
+
+    std::mutex mutex_;
+    std::condition_variable condVar_;
+    std::deque<std::string> closedFiles_;
+    std::string activeFile_;
+    bool running_;
+    std::thread thread_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Layout of the files written by VHBinaryFileSink and read by vhlog-decode.
+//
+// header:  "VHLOGBIN", u8 version, u8 1 when little endian, i64 file start time in
+//          nanoseconds since the epoch
+// frames:  u8 kind << 4 | level, then
+//   Format   varint id, varint length, format string, varint length, type tags
+//   Message  zigzag varint nanoseconds since the previous frame, varint format id,
+//            the arguments as encoded by VHLogArgCodec
+//   Text     zigzag varint nanoseconds since the previous frame, varint length, text
+// A Format frame precedes the first Message using its id in every file. Values are
+// stored in the byte order of the writer.
+
+inline constexpr char VHLOG_BINARY_MAGIC[8] = {'V', 'H', 'L', 'O', 'G', 'B', 'I', 'N'};
+inline constexpr std::uint8_t VHLOG_BINARY_VERSION = 1;
+inline constexpr std::size_t VHLOG_BINARY_HEADER_SIZE = sizeof(VHLOG_BINARY_MAGIC) + 2 + sizeof(std::int64_t);
+
+enum class VHLogBinaryFrame : std::uint8_t {
+    Format = 1,
+    Message = 2,
+    Text = 3
+};
+
+inline void vhlogPutVarint(std::string& out, std::uint64_t value) {
+
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void vhlogPutSignedVarint(std::string& out, std::int64_t value) {
+
+    vhlogPutVarint(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+inline bool vhlogGetVarint(const char*& in, const char* end, std::uint64_t& value) {
+
+    value = 0;
+    for (int shift = 0; in != end && shift < 64; shift += 7) {
+        auto byte = static_cast<std::uint8_t>(*in++);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool vhlogGetSignedVarint(const char*& in, const char* end, std::int64_t& value) {
+
+    std::uint64_t encoded = 0;
+    if (!vhlogGetVarint(in, end, encoded)) {
+        return false;
+    }
+    value = static_cast<std::int64_t>(encoded >> 1) ^ -static_cast<std::int64_t>(encoded & 1);
+    return true;
+}
+
+// Encoded size of one argument starting at in, 0 when the tag is unknown or the bytes
+// run past end.
+inline std::size_t vhlogEncodedArgSize(char tag, const char* in, const char* end) {
+
+    std::size_t size = 0;
+    switch (tag) {
+        case 'b': case 'c': case 'a': case 'A': size = 1; break;
+        case 'h': case 'H': size = 2; break;
+        case 'i': case 'I': case 'f': size = 4; break;
+        case 'l': case 'L': case 'd': size = 8; break;
+        case 'p': size = sizeof(void*); break;
+        case 's':
+            if (end - in >= static_cast<std::ptrdiff_t>(sizeof(std::uint32_t))) {
+                std::uint32_t length = 0;
+                std::memcpy(&length, in, sizeof(length));
+                size = sizeof(length) + length;
+            }
+            break;
+        default:
+            return 0;
+    }
+    return end - in >= static_cast<std::ptrdiff_t>(size) ? size : 0;
+}
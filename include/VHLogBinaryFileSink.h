@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "VHLogBinary.h"
+#include "VHLogFields.h"
+#include "VHLogFileSink.h"
+
+// Rotating file sink writing the compact format described in VHLogBinary.h to
+// {basePathAndName}_{date_time}.vhlb files. Deferred messages are stored as a format id,
+// a timestamp delta and their raw argument bytes, with each format string written once
+// per file, so the logger skips text formatting when no other sink needs it. Turn the
+// files back into text with the vhlog-decode tool.
+class VHBinaryFileSink : public VHFileSink {
+public:
+    explicit VHBinaryFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024,
+                              std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+    bool needsText() const override { return false; }
+
+protected:
+    std::size_t appendRecord(const VHLogRecord& record) override;
+    void fileOpened() override;
+
+private:
+    // Call sites are told apart by the addresses of their format string and type tags.
+    using FormatKey = std::pair<const char*, const char*>;
+    struct FormatKeyHash {
+        std::size_t operator()(const FormatKey& key) const {
+            return std::hash<const char*>()(key.first) ^ (std::hash<const char*>()(key.second) << 1);
+        }
+    };
+
+    std::unordered_map<FormatKey, std::uint64_t, FormatKeyHash> formatIds_;
+    std::int64_t lastTimestamp_;
+    std::string frame_;
+    // Message and fields of a structured record, flattened into one Text frame.
+    std::string fieldsText_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VHLOG_HAS_RDTSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define VHLOG_HAS_RDTSC 1
+#endif
+
+// Call-site clock. Producers only read ticks() (a single rdtsc on x86, steady_clock
+// elsewhere); the logger thread owns a VHLogClock that maps ticks to wall-clock time
+// through a calibrated anchor it refreshes every RECALIBRATE_INTERVAL.
+class VHLogClock {
+public:
+    static constexpr std::chrono::milliseconds RECALIBRATE_INTERVAL{1000};
+
+    static std::uint64_t ticks() noexcept {
+#ifdef VHLOG_HAS_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    VHLogClock() {
+
+        takeAnchor();
+        // Spin briefly for a first tick rate estimate, recalibrate() refines it.
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1)) {
+        }
+        recalibrate();
+    }
+
+    bool shouldRecalibrate(std::uint64_t nowTicks) const {
+        return static_cast<double>(nowTicks - anchorTicks_) * nsPerTick_ >= RECALIBRATE_NS;
+    }
+
+    void recalibrate() {
+
+        std::uint64_t previousTicks = anchorTicks_;
+        std::int64_t previousSteadyNs = anchorSteadyNs_;
+        takeAnchor();
+        if (anchorTicks_ > previousTicks && anchorSteadyNs_ > previousSteadyNs) {
+            nsPerTick_ = static_cast<double>(anchorSteadyNs_ - previousSteadyNs) /
+                         static_cast<double>(anchorTicks_ - previousTicks);
+        }
+    }
+
+    std::chrono::system_clock::time_point toSystemTime(std::uint64_t ticks) const {
+
+        auto delta = static_cast<std::int64_t>(ticks - anchorTicks_);
+        auto ns = anchorSystemNs_ + static_cast<std::int64_t>(static_cast<double>(delta) * nsPerTick_);
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+private:
+    static constexpr double RECALIBRATE_NS =
+        std::chrono::duration<double, std::nano>(RECALIBRATE_INTERVAL).count();
+
+    void takeAnchor() {
+
+        anchorTicks_ = ticks();
+        anchorSteadyNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        anchorSystemNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::uint64_t anchorTicks_ = 0;
+    std::int64_t anchorSteadyNs_ = 0;
+    std::int64_t anchorSystemNs_ = 0;
+    double nsPerTick_ = 1.0;
+};
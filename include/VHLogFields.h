@@ -0,0 +1,142 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Structured key/value fields, as in
+//   logger.log(VHLogLevel::INFOLV, "order filled", {{"orderId", 42}, {"side", "buy"}});
+// They travel in the queued record right after the message text: a type tag, the key
+// and the value's bytes for each field. The logger thread renders them for each sink's
+// layout (see VHLogLayout), keys are written as given and should be plain identifiers.
+enum class VHLogFieldType : char {
+    Int = 'l',
+    UInt = 'L',
+    Double = 'd',
+    Bool = 'b',
+    String = 's'
+};
+
+struct VHLogField {
+    VHLogField() = default;
+
+    template <typename T>
+        requires std::is_integral_v<T> && (!std::is_same_v<T, bool>)
+    VHLogField(std::string_view key, T value) : key(key) {
+
+        if constexpr (std::is_signed_v<T>) {
+            type = VHLogFieldType::Int;
+            intValue = value;
+        }
+        else {
+            type = VHLogFieldType::UInt;
+            uintValue = value;
+        }
+    }
+
+    template <std::floating_point T>
+    VHLogField(std::string_view key, T value) : key(key), type(VHLogFieldType::Double), doubleValue(value) {}
+    VHLogField(std::string_view key, bool value) : key(key), type(VHLogFieldType::Bool), boolValue(value) {}
+    VHLogField(std::string_view key, std::string_view value) : key(key), type(VHLogFieldType::String), text(value) {}
+    VHLogField(std::string_view key, const char* value) : VHLogField(key, std::string_view(value)) {}
+    VHLogField(std::string_view key, const std::string& value) : VHLogField(key, std::string_view(value)) {}
+
+    std::string_view key;
+    VHLogFieldType type = VHLogFieldType::Int;
+    union {
+        std::int64_t intValue = 0;
+        std::uint64_t uintValue;
+        double doubleValue;
+        bool boolValue;
+    };
+    // String fields only.
+    std::string_view text;
+};
+
+inline std::size_t vhlogFieldsSize(std::initializer_list<VHLogField> fields) {
+
+    std::size_t size = 0;
+    for (const auto& field : fields) {
+        size += 1 + sizeof(std::uint32_t) + field.key.size();
+        size += field.type == VHLogFieldType::String ? sizeof(std::uint32_t) + field.text.size() :
+                field.type == VHLogFieldType::Bool ? 1 : sizeof(std::uint64_t);
+    }
+    return size;
+}
+
+inline char* vhlogEncodeString(char* out, std::string_view text) {
+
+    auto length = static_cast<std::uint32_t>(text.size());
+    std::memcpy(out, &length, sizeof(length));
+    std::memcpy(out + sizeof(length), text.data(), length);
+    return out + sizeof(length) + length;
+}
+
+inline char* vhlogEncodeFields(char* out, std::initializer_list<VHLogField> fields) {
+
+    for (const auto& field : fields) {
+        *out++ = static_cast<char>(field.type);
+        out = vhlogEncodeString(out, field.key);
+        switch (field.type) {
+            case VHLogFieldType::String:
+                out = vhlogEncodeString(out, field.text);
+                break;
+            case VHLogFieldType::Bool:
+                *out++ = field.boolValue ? 1 : 0;
+                break;
+            default:
+                std::memcpy(out, &field.uintValue, sizeof(field.uintValue));
+                out += sizeof(field.uintValue);
+        }
+    }
+    return out;
+}
+
+// Calls fn with every field encoded in fields. String views point into fields.
+template <typename Fn>
+void vhlogForEachField(std::string_view fields, Fn&& fn) {
+
+    auto decodeString = [](const char*& in) {
+        std::uint32_t length = 0;
+        std::memcpy(&length, in, sizeof(length));
+        std::string_view text(in + sizeof(length), length);
+        in += sizeof(length) + length;
+        return text;
+    };
+
+    const char* in = fields.data();
+    const char* end = in + fields.size();
+    while (in < end) {
+        VHLogField field;
+        field.type = static_cast<VHLogFieldType>(*in++);
+        field.key = decodeString(in);
+        switch (field.type) {
+            case VHLogFieldType::String:
+                field.text = decodeString(in);
+                break;
+            case VHLogFieldType::Bool:
+                field.boolValue = *in++ != 0;
+                break;
+            default:
+                std::memcpy(&field.uintValue, in, sizeof(field.uintValue));
+                in += sizeof(field.uintValue);
+        }
+        fn(field);
+    }
+}
+
+// Encoders used by the logger thread, see VHLogFields.cpp.
+
+// Appends text escaped for use inside a JSON string.
+void vhlogAppendJsonEscaped(std::string& out, std::string_view text);
+// Appends ,"key":value for every encoded field.
+void vhlogAppendJsonFields(std::string& out, std::string_view fields);
+// Appends text as a logfmt value, quoted when it holds spaces, '=', quotes or control
+// characters.
+void vhlogAppendLogfmtValue(std::string& out, std::string_view text);
+// Appends " key=value" for every encoded field.
+void vhlogAppendLogfmtFields(std::string& out, std::string_view fields);
@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "VHLogArchiver.h"
+#include "VHLogRingBuffer.h"
+#include "VHLogSink.h"
+
+// When a file sink starts a new file besides reaching maxSize.
+enum class VHLogRotation {
+    Size,
+    Daily,
+    Hourly,
+    Minutes
+};
+
+// How far a file sink pushes lines towards the disk.
+enum class VHLogDurability {
+    // Lines reach the OS only when the buffer fills, on rotation and on close.
+    None,
+    // Also on ERROR/FATAL and whenever the logger runs out of work (the default).
+    FlushToOS,
+    // FlushToOS, plus an fdatasync on the helper thread at most every syncInterval,
+    // covering everything written before it.
+    SyncInterval,
+    // FlushToOS, plus an fdatasync before the logger moves on from a batch holding a
+    // line of syncLevel or above; one sync covers the whole batch.
+    SyncOnLevel
+};
+
+struct VHLogDurabilityPolicy {
+    VHLogDurability mode = VHLogDurability::FlushToOS;
+    std::chrono::milliseconds syncInterval{1000};
+    VHLogLevel syncLevel = VHLogLevel::ERRORLV;
+};
+
+// Rotating text file sink. Files are named {basePathAndName}_{date_time}.log and a new
+// one is started when maxSize would be exceeded or, by default, at local midnight.
+// A helper thread opens the next file ahead of time under a temporary name, then names,
+// syncs and closes the files the sink is done with, so rotating only swaps descriptors
+// on the logger thread. If the next file is not ready yet the sink keeps writing to the
+// current one a little longer rather than wait.
+// Lines are collected in a bufferSize buffer (64KB to 4MB) and written to the raw file
+// descriptor with a single write() when it fills up, on ERROR/FATAL, on rotation and
+// when the logger thread runs out of work.
+class VHFileSink : public VHLogSink {
+public:
+    static constexpr std::size_t MIN_BUFFER_SIZE = 64 * 1024;
+    static constexpr std::size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
+
+    explicit VHFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024,
+                        std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~VHFileSink() override;
+
+    void write(std::span<const VHLogRecord> records) override;
+    void flush() override;
+
+    // Daily, Hourly and Minutes rotate at those local time boundaries as well as by
+    // size; Minutes starts a file every interval counted from midnight. Call it
+    // before adding the sink to a logger.
+    void setRotationPolicy(VHLogRotation rotation, std::chrono::minutes interval = std::chrono::minutes(60));
+
+    // Hands every file this sink closes to a background VHLogArchiver. Call it before
+    // adding the sink to a logger.
+    void setArchivePolicy(const VHLogArchivePolicy& policy);
+
+    // Call it before adding the sink to a logger.
+    void setDurabilityPolicy(const VHLogDurabilityPolicy& policy);
+
+protected:
+    // readWrite opens the files O_RDWR instead of write only, as shared mappings need.
+    VHFileSink(const std::string& basePathAndName, std::size_t maxSize, std::size_t bufferSize, bool readWrite,
+               std::string_view extension = ".log");
+
+    // Hooks for sinks that replace what or how bytes reach the file. appendRecord
+    // receives every accepted record and returns the number of bytes it appended, the
+    // default appends the line; append receives those bytes; writeBuffer must leave
+    // buffer_ empty with at least bufferSize_ bytes of capacity; fileOpened runs after
+    // every successful open and fileClosing before every close.
+    virtual std::size_t appendRecord(const VHLogRecord& record);
+    virtual void append(std::string_view line);
+    virtual void writeBuffer(std::string_view extra = {});
+    virtual void fileOpened() {}
+    virtual void fileClosing() {}
+    // Forces what was written so far to disk, on the logger thread. Sinks with writes
+    // still in flight or kept outside the descriptor complete them first.
+    virtual void syncFile();
+    // Gets every line so far into the descriptor before the helper syncs it for
+    // SyncInterval. The default writes the buffer out.
+    virtual void prepareSync() { writeBuffer(); }
+
+    int fd_;
+    std::string buffer_;
+    std::size_t bufferSize_;
+    std::string basePathAndName_;
+    std::size_t maxSize_;
+
+private:
+    struct RetiredFile {
+        int fd = -1;
+        std::chrono::sys_seconds rotatedAt{};
+    };
+
+    void openFile();
+    void closeFile();
+    bool rotateFileSink();
+    void scheduleRotation(std::chrono::sys_seconds now);
+    std::string fileNameFor(std::chrono::sys_seconds time, int sequence = 0) const;
+
+    void helperWorker();
+    void signalHelper();
+    void prepareNextFile();
+    void retireFile(const RetiredFile& retired);
+    void requestSync();
+    void reclaimDeferredSync();
+    void runPendingSync(std::uint32_t seen);
+
+    std::size_t currentSize_;
+    bool readWrite_;
+    std::string extension_;
+    // Owned by the helper thread once it runs.
+    std::string currentFileName_;
+    std::unique_ptr<VHLogArchiver> archiver_;
+    const std::chrono::time_zone* timeZone_;
+
+    // Compared with each record's timestamp, computed once per file.
+    VHLogRotation rotation_;
+    std::chrono::minutes rotationInterval_;
+    std::chrono::system_clock::time_point nextRotation_;
+    bool rotationRequested_;
+
+    VHLogDurabilityPolicy durability_;
+
+    // Handoff with the helper thread: it publishes the next descriptor in readyFd_ and
+    // only prepares another one after the logger thread returned the old descriptor
+    // through retiredFiles_. helperSignal_ wakes it up.
+    std::atomic<int> readyFd_{-1};
+    VHLogSpscBuffer<RetiredFile> retiredFiles_{4};
+    std::atomic<std::uint32_t> helperSignal_{0};
+    std::atomic<bool> helperRunning_{true};
+    std::atomic<bool> fileWanted_{false};
+    // SyncInterval: the descriptor the helper should fdatasync once syncDue_ (steady
+    // clock ticks) has passed, -1 when none is pending. nextSync_ is the earliest due
+    // time of the next one; syncDeferred_ is set while the pending one was requested
+    // ahead of its due time, see requestSync().
+    std::atomic<int> syncFd_{-1};
+    std::atomic<std::int64_t> syncDue_{0};
+    std::chrono::steady_clock::time_point nextSync_;
+    bool syncDeferred_ = false;
+    bool nextFilePublished_;
+    std::string nextFileName_;
+    std::thread helperThread_;
+};
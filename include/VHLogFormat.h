@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Deferred formatting support. log(level, fmt, args...) stores the arguments as raw
+// bytes next to the format string and the logger thread rebuilds them to run
+// std::vformat. Strings are copied as length-prefixed bytes, arithmetic types, enums
+// and void pointers verbatim; other arguments are formatted on the calling thread (see
+// VHLogDeferrableArg).
+
+// Appends the formatted message to out.
+using VHLogFormatFn = void (*)(std::string& out, std::string_view format, const char* args);
+
+// One character per encoded argument, so sinks that store the raw bytes (see
+// VHLogBinary.h) can be decoded without the program that wrote them. Zero for types
+// only the writing program knows how to format.
+template <typename T>
+constexpr char vhlogTypeTag() {
+
+    if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        return 's';
+    }
+    else if constexpr (std::is_same_v<T, bool>) {
+        return 'b';
+    }
+    else if constexpr (std::is_same_v<T, char>) {
+        return 'c';
+    }
+    else if constexpr (std::is_same_v<T, wchar_t> || std::is_same_v<T, char8_t> ||
+                       std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>) {
+        return 0;
+    }
+    else if constexpr (std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint64_t)) {
+        // Wider integers (__int128) have no tag, the decoder reads at most 8 bytes.
+        constexpr int index = sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3;
+        return std::is_signed_v<T> ? "ahil"[index] : "AHIL"[index];
+    }
+    else if constexpr (std::is_same_v<T, float>) {
+        return 'f';
+    }
+    else if constexpr (std::is_same_v<T, double>) {
+        return 'd';
+    }
+    else if constexpr (std::is_same_v<T, const void*> || std::is_same_v<T, void*>) {
+        return 'p';
+    }
+    else {
+        return 0;
+    }
+}
+
+template <typename T>
+struct VHLogArgCodec {
+    static constexpr bool isString = std::is_convertible_v<const T&, std::string_view>;
+    static constexpr char typeTag = vhlogTypeTag<T>();
+    using Stored = std::conditional_t<isString, std::string_view, T>;
+
+    static std::size_t size(const T& value) {
+
+        if constexpr (isString) {
+            return sizeof(std::uint32_t) + std::string_view(value).size();
+        }
+        else {
+            return sizeof(T);
+        }
+    }
+
+    static char* encode(char* out, const T& value) {
+
+        if constexpr (isString) {
+            std::string_view view(value);
+            auto length = static_cast<std::uint32_t>(view.size());
+            std::memcpy(out, &length, sizeof(length));
+            std::memcpy(out + sizeof(length), view.data(), length);
+            return out + sizeof(length) + length;
+        }
+        else {
+            std::memcpy(out, &value, sizeof(T));
+            return out + sizeof(T);
+        }
+    }
+
+    static const char* decode(const char* in, Stored& value) {
+
+        if constexpr (isString) {
+            std::uint32_t length = 0;
+            std::memcpy(&length, in, sizeof(length));
+            value = std::string_view(in + sizeof(length), length);
+            return in + sizeof(length) + length;
+        }
+        else {
+            std::memcpy(&value, in, sizeof(T));
+            return in + sizeof(T);
+        }
+    }
+};
+
+// Arguments that can cross to the logger thread as bytes: strings (their characters are
+// copied), arithmetic types, enums and void pointers. Anything else is formatted on the
+// calling thread, since its bytes may refer to memory the caller frees before the logger
+// thread gets to it (spans, views, structs holding pointers) and arrays cannot be stored.
+template <typename T>
+concept VHLogDeferrableArg = VHLogArgCodec<T>::isString || std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+    std::is_same_v<T, const void*> || std::is_same_v<T, void*>;
+
+template <typename... Args>
+std::size_t vhlogEncodedSize(const Args&... args) {
+    return (std::size_t{0} + ... + VHLogArgCodec<Args>::size(args));
+}
+
+template <typename... Args>
+void vhlogEncodeArgs(char* out, const Args&... args) {
+    ((out = VHLogArgCodec<Args>::encode(out, args)), ...);
+}
+
+// Type tags of a whole signature, nullptr when any argument has none.
+template <typename... Args>
+const char* vhlogArgTypes() {
+
+    if constexpr (((VHLogArgCodec<Args>::typeTag != 0) && ...)) {
+        static constexpr char tags[] = {VHLogArgCodec<Args>::typeTag..., '\0'};
+        return tags;
+    }
+    else {
+        return nullptr;
+    }
+}
+
+template <typename... Args>
+void vhlogFormatDeferred(std::string& out, std::string_view format, const char* args) {
+
+    std::tuple<typename VHLogArgCodec<Args>::Stored...> values;
+    std::apply([&args](auto&... value) {
+        ((args = VHLogArgCodec<Args>::decode(args, value)), ...);
+    }, values);
+    std::apply([&out, format](auto&... value) {
+        std::vformat_to(std::back_inserter(out), format, std::make_format_args(value...));
+    }, values);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "VHLogFileSink.h"
+
+// File sink compressing on the logger thread to {basePathAndName}_{date_time}.log.gz.
+// The file is a series of gzip members ("frames"), each decodable on its own and
+// read back in one go by zcat or gzip -d. A frame is closed every frameInterval, after
+// MAX_FRAME_INPUT bytes of text, on ERROR/FATAL and on rotation. When the logger runs
+// out of work the open frame is sync-flushed, at most once per frameInterval, so a
+// crash loses its trailer and the lines logged since that flush.
+// maxSize counts uncompressed bytes. Without a USE_ZLIB build it writes plain text
+// to .log files like VHFileSink.
+class VHGzipFileSink : public VHFileSink {
+public:
+    static constexpr std::size_t MAX_FRAME_INPUT = 4 * 1024 * 1024;
+
+    explicit VHGzipFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024,
+                            std::chrono::milliseconds frameInterval = std::chrono::milliseconds(1000),
+                            int compressionLevel = 6, std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~VHGzipFileSink() override;
+
+    void write(std::span<const VHLogRecord> records) override;
+    void flush() override;
+
+protected:
+    void writeBuffer(std::string_view extra = {}) override;
+    void fileOpened() override;
+    void fileClosing() override;
+    void syncFile() override;
+    void prepareSync() override;
+
+private:
+    struct Stream;
+
+    void compress(std::string_view input, int mode);
+    void finishFrame();
+    void writeCompressed();
+
+    std::unique_ptr<Stream> stream_;
+    std::string compressed_;
+    std::chrono::milliseconds frameInterval_;
+    std::chrono::steady_clock::time_point frameStart_;
+    std::chrono::steady_clock::time_point lastSyncFlush_;
+    std::size_t frameInput_;
+    bool closeFrame_;
+    bool syncFrame_;
+};
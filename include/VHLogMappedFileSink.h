@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "VHLogFileSink.h"
+
+// File sink that preallocates every log file up to maxSize (capped at
+// MAX_SEGMENT_SIZE, grown by another segment if a file runs past it) and maps it, so
+// lines are copied straight into the page cache with no system call per write. They
+// survive a crash of the process as soon as they are copied. msync/madvise only run
+// when the sink is flushed, and the file is truncated to the bytes actually written on
+// rotation and close; after a power loss or kill -9 the file may end in zero bytes.
+// POSIX only, elsewhere or when mapping fails it behaves like VHFileSink.
+class VHMappedFileSink : public VHFileSink {
+public:
+    static constexpr std::size_t MIN_SEGMENT_SIZE = 64 * 1024;
+    static constexpr std::size_t MAX_SEGMENT_SIZE = 1024 * 1024 * 1024;
+
+    explicit VHMappedFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024);
+    ~VHMappedFileSink() override;
+
+    bool usingMapping() const { return mapping_ != nullptr; }
+
+protected:
+    void append(std::string_view line) override;
+    void writeBuffer(std::string_view extra = {}) override;
+    void fileOpened() override;
+    void fileClosing() override;
+
+private:
+    bool mapSegment(std::uint64_t offset, std::size_t size);
+    void unmapSegment();
+
+    char* mapping_;
+    std::size_t mappingLength_;
+    // File offset of the first mapped byte, always page aligned.
+    std::uint64_t mappingOffset_;
+    // Write position and the part already handed to msync, relative to mapping_.
+    std::size_t position_;
+    std::size_t syncedPosition_;
+};
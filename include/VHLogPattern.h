@@ -0,0 +1,295 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "VHLogFields.h"
+#include "VHLogRecord.h"
+
+// Line layouts given as a pattern, e.g. "%Y-%m-%dT%H:%M:%S.%f %l [%t] %v":
+//   %Y %m %d %H %M %S   local date and time
+//   %e %f %F            milliseconds, microseconds, nanoseconds (3, 6 and 9 digits)
+//   %l                  level name
+//   %t                  number of the logging thread, assigned as threads first log
+//   %v                  the message, followed by its fields as key=value pairs
+//   %%                  a percent sign
+// Anything else is copied as is, and every line ends with a newline. The pattern is
+// parsed once into a flat list of steps, rendering a line only walks that list.
+
+enum class VHLogPatternOp : std::uint8_t {
+    Literal,
+    Year,
+    Month,
+    Day,
+    Hour,
+    Minute,
+    Second,
+    Milliseconds,
+    Microseconds,
+    Nanoseconds,
+    Level,
+    Thread,
+    Message
+};
+
+struct VHLogPatternStep {
+    VHLogPatternOp op = VHLogPatternOp::Literal;
+    // Literal steps only: where the text is in the pattern.
+    std::uint16_t offset = 0;
+    std::uint16_t length = 0;
+};
+
+// Broken-down call site time, the logger thread refreshes the date part once a second.
+struct VHLogTimeFields {
+    int year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    unsigned hour = 0;
+    unsigned minute = 0;
+    unsigned second = 0;
+    std::uint32_t nanosecond = 0;
+};
+
+// Calls emit with every step of pattern, adjacent literal text is merged into one step.
+// Runs in constant expressions too, see VHLogPattern::compiled().
+template <typename Emit>
+constexpr void vhlogParsePattern(std::string_view pattern, Emit&& emit) {
+
+    std::size_t literalStart = 0;
+    auto flushLiteral = [&](std::size_t end) {
+        if (end > literalStart) {
+            emit(VHLogPatternStep{VHLogPatternOp::Literal, static_cast<std::uint16_t>(literalStart),
+                                  static_cast<std::uint16_t>(end - literalStart)});
+        }
+    };
+
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%' || i + 1 == pattern.size()) {
+            continue;
+        }
+        if (pattern[i + 1] == '%') {
+            // Keep the second '%' as the start of the next literal.
+            flushLiteral(i);
+            literalStart = i + 1;
+            ++i;
+            continue;
+        }
+        // The conversion letters in VHLogPatternOp order, unknown ones are copied as is.
+        std::size_t conversion = std::string_view("YmdHMSefFltv").find(pattern[i + 1]);
+        if (conversion == std::string_view::npos) {
+            continue;
+        }
+        auto op = static_cast<VHLogPatternOp>(conversion + 1);
+        flushLiteral(i);
+        emit(VHLogPatternStep{op});
+        literalStart = i + 2;
+        ++i;
+    }
+    flushLiteral(pattern.size());
+}
+
+inline void vhlogAppendDigits(std::string& out, std::uint64_t value, int width) {
+
+    char buffer[20];
+    for (int i = width - 1; i >= 0; --i) {
+        buffer[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    out.append(buffer, width);
+}
+
+inline void vhlogAppendNumber(std::string& out, std::uint64_t value) {
+
+    char buffer[20];
+    char* end = buffer + sizeof(buffer);
+    char* start = end;
+    do {
+        *--start = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(start, end);
+}
+
+// Appends what op stands for. Literal steps are handled by the callers.
+template <VHLogPatternOp Op>
+void vhlogAppendPatternOp(std::string& out, const VHLogRecord& record, const VHLogTimeFields& time) {
+
+    if constexpr (Op == VHLogPatternOp::Year) {
+        vhlogAppendDigits(out, static_cast<std::uint64_t>(time.year), 4);
+    }
+    else if constexpr (Op == VHLogPatternOp::Month) {
+        vhlogAppendDigits(out, time.month, 2);
+    }
+    else if constexpr (Op == VHLogPatternOp::Day) {
+        vhlogAppendDigits(out, time.day, 2);
+    }
+    else if constexpr (Op == VHLogPatternOp::Hour) {
+        vhlogAppendDigits(out, time.hour, 2);
+    }
+    else if constexpr (Op == VHLogPatternOp::Minute) {
+        vhlogAppendDigits(out, time.minute, 2);
+    }
+    else if constexpr (Op == VHLogPatternOp::Second) {
+        vhlogAppendDigits(out, time.second, 2);
+    }
+    else if constexpr (Op == VHLogPatternOp::Milliseconds) {
+        vhlogAppendDigits(out, time.nanosecond / 1000000, 3);
+    }
+    else if constexpr (Op == VHLogPatternOp::Microseconds) {
+        vhlogAppendDigits(out, time.nanosecond / 1000, 6);
+    }
+    else if constexpr (Op == VHLogPatternOp::Nanoseconds) {
+        vhlogAppendDigits(out, time.nanosecond, 9);
+    }
+    else if constexpr (Op == VHLogPatternOp::Level) {
+        out += vhlogLevelName(record.level);
+    }
+    else if constexpr (Op == VHLogPatternOp::Thread) {
+        vhlogAppendNumber(out, record.thread);
+    }
+    else if constexpr (Op == VHLogPatternOp::Message) {
+        out += record.message;
+        if (!record.fields.empty()) {
+            vhlogAppendLogfmtFields(out, record.fields);
+        }
+    }
+}
+
+// A pattern known at compile time, usable as a template argument.
+template <std::size_t N>
+struct VHLogPatternString {
+    constexpr VHLogPatternString(const char (&text)[N]) { std::copy_n(text, N, data); }
+    constexpr std::string_view view() const { return std::string_view(data, N - 1); }
+
+    char data[N];
+};
+
+class VHLogPattern {
+public:
+    // Parses pattern into steps that are walked for every line.
+    explicit VHLogPattern(std::string_view pattern) : pattern_(pattern), render_(&renderSteps) {
+
+        vhlogParsePattern(pattern_, [this](VHLogPatternStep step) { steps_.push_back(step); });
+    }
+
+    // Parses Pattern at compile time. The renderer is generated for exactly these
+    // steps, with no loop and no dispatch left at run time.
+    template <VHLogPatternString Pattern>
+    static VHLogPattern compiled() {
+
+        VHLogPattern pattern;
+        pattern.pattern_ = Pattern.view();
+        pattern.render_ = &renderCompiled<Pattern>;
+        return pattern;
+    }
+
+    // Appends the line for record, newline included.
+    void format(std::string& out, const VHLogRecord& record, const VHLogTimeFields& time) const {
+        render_(*this, out, record, time);
+    }
+
+    const std::string& pattern() const { return pattern_; }
+
+private:
+    using RenderFn = void (*)(const VHLogPattern& pattern, std::string& out, const VHLogRecord& record,
+                              const VHLogTimeFields& time);
+
+    VHLogPattern() = default;
+
+    static void renderSteps(const VHLogPattern& pattern, std::string& out, const VHLogRecord& record,
+                            const VHLogTimeFields& time) {
+
+        for (const auto& step : pattern.steps_) {
+            switch (step.op) {
+                case VHLogPatternOp::Literal:
+                    out.append(pattern.pattern_, step.offset, step.length);
+                    break;
+                case VHLogPatternOp::Year:
+                    vhlogAppendPatternOp<VHLogPatternOp::Year>(out, record, time);
+                    break;
+                case VHLogPatternOp::Month:
+                    vhlogAppendPatternOp<VHLogPatternOp::Month>(out, record, time);
+                    break;
+                case VHLogPatternOp::Day:
+                    vhlogAppendPatternOp<VHLogPatternOp::Day>(out, record, time);
+                    break;
+                case VHLogPatternOp::Hour:
+                    vhlogAppendPatternOp<VHLogPatternOp::Hour>(out, record, time);
+                    break;
+                case VHLogPatternOp::Minute:
+                    vhlogAppendPatternOp<VHLogPatternOp::Minute>(out, record, time);
+                    break;
+                case VHLogPatternOp::Second:
+                    vhlogAppendPatternOp<VHLogPatternOp::Second>(out, record, time);
+                    break;
+                case VHLogPatternOp::Milliseconds:
+                    vhlogAppendPatternOp<VHLogPatternOp::Milliseconds>(out, record, time);
+                    break;
+                case VHLogPatternOp::Microseconds:
+                    vhlogAppendPatternOp<VHLogPatternOp::Microseconds>(out, record, time);
+                    break;
+                case VHLogPatternOp::Nanoseconds:
+                    vhlogAppendPatternOp<VHLogPatternOp::Nanoseconds>(out, record, time);
+                    break;
+                case VHLogPatternOp::Level:
+                    vhlogAppendPatternOp<VHLogPatternOp::Level>(out, record, time);
+                    break;
+                case VHLogPatternOp::Thread:
+                    vhlogAppendPatternOp<VHLogPatternOp::Thread>(out, record, time);
+                    break;
+                case VHLogPatternOp::Message:
+                    vhlogAppendPatternOp<VHLogPatternOp::Message>(out, record, time);
+                    break;
+            }
+        }
+        out += '\n';
+    }
+
+    template <VHLogPatternString Pattern>
+    static constexpr std::size_t compiledStepCount() {
+
+        std::size_t count = 0;
+        vhlogParsePattern(Pattern.view(), [&count](VHLogPatternStep) { ++count; });
+        return count;
+    }
+
+    template <VHLogPatternString Pattern>
+    static constexpr auto compiledSteps() {
+
+        std::array<VHLogPatternStep, compiledStepCount<Pattern>()> steps{};
+        std::size_t index = 0;
+        vhlogParsePattern(Pattern.view(), [&steps, &index](VHLogPatternStep step) { steps[index++] = step; });
+        return steps;
+    }
+
+    template <VHLogPatternString Pattern>
+    static void renderCompiled(const VHLogPattern&, std::string& out, const VHLogRecord& record,
+                               const VHLogTimeFields& time) {
+
+        static constexpr auto steps = compiledSteps<Pattern>();
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (renderCompiledStep<Pattern, steps[I]>(out, record, time), ...);
+        }(std::make_index_sequence<steps.size()>());
+        out += '\n';
+    }
+
+    template <VHLogPatternString Pattern, VHLogPatternStep Step>
+    static void renderCompiledStep(std::string& out, const VHLogRecord& record, const VHLogTimeFields& time) {
+
+        if constexpr (Step.op == VHLogPatternOp::Literal) {
+            out.append(Pattern.data + Step.offset, Step.length);
+        }
+        else {
+            vhlogAppendPatternOp<Step.op>(out, record, time);
+        }
+    }
+
+    std::string pattern_;
+    std::vector<VHLogPatternStep> steps_;
+    RenderFn render_ = nullptr;
+};
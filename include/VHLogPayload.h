@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// The bytes of a queued message: plain text or encoded arguments. Up to
+// INLINE_CAPACITY bytes are stored in the object itself, so a message travels through
+// the preallocated queue slots and the worker's batch without touching the heap.
+// Larger payloads live in a heap string that moves along with the object, or is
+// adopted as is from an rvalue std::string; moves swap those strings, so a slot keeps
+// a block around for the next large message.
+class VHLogPayload {
+public:
+    static constexpr std::size_t INLINE_CAPACITY = 152;
+
+    VHLogPayload() = default;
+    VHLogPayload(const VHLogPayload& other) { assign(other.view()); }
+    VHLogPayload(VHLogPayload&& other) noexcept { moveFrom(other); }
+
+    VHLogPayload& operator=(const VHLogPayload& other) {
+
+        if (this != &other) {
+            assign(other.view());
+        }
+        return *this;
+    }
+
+    VHLogPayload& operator=(VHLogPayload&& other) noexcept {
+
+        if (this != &other) {
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    VHLogPayload& operator=(std::string_view text) {
+
+        assign(text);
+        return *this;
+    }
+
+    // The content is unspecified afterwards, callers write it through data().
+    void resize(std::size_t size) {
+
+        if (size > INLINE_CAPACITY) {
+            heap_.resize(size);
+        }
+        size_ = size;
+    }
+
+    // Keeps the first size bytes.
+    void truncate(std::size_t size) {
+
+        if (size >= size_) {
+            return;
+        }
+        if (size_ > INLINE_CAPACITY && size <= INLINE_CAPACITY) {
+            std::memcpy(inline_, heap_.data(), size);
+        }
+        size_ = size;
+    }
+
+    void assign(std::string_view text) {
+
+        resize(text.size());
+        if (!text.empty()) {
+            std::memcpy(data(), text.data(), text.size());
+        }
+    }
+
+    void assign(std::string&& text) {
+
+        if (text.size() <= INLINE_CAPACITY) {
+            assign(std::string_view(text));
+            return;
+        }
+        heap_.swap(text);
+        size_ = heap_.size();
+    }
+
+    char* data() { return size_ > INLINE_CAPACITY ? heap_.data() : inline_; }
+    const char* data() const { return size_ > INLINE_CAPACITY ? heap_.data() : inline_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::string_view view() const { return std::string_view(data(), size_); }
+    operator std::string_view() const { return view(); }
+
+private:
+    void moveFrom(VHLogPayload& other) {
+
+        size_ = std::exchange(other.size_, 0);
+        if (size_ > INLINE_CAPACITY) {
+            heap_.swap(other.heap_);
+        }
+        else if (size_ > 0) {
+            std::memcpy(inline_, other.inline_, size_);
+        }
+    }
+
+    std::size_t size_ = 0;
+    std::string heap_;
+    char inline_[INLINE_CAPACITY];
+};
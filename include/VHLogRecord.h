@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+enum class VHLogLevel {
+    DEBUGLV,
+    INFOLV,
+    WARNINGLV,
+    ERRORLV,
+    FATALLV
+};
+
+inline const char* vhlogLevelName(VHLogLevel level) {
+
+    static constexpr const char* levels[] = {
+        "DEBUG", "INFO", "WARNING", "ERROR", "FATAL", "UNKNOWN"
+    };
+    return levels[std::min(static_cast<int>(level), 5)];
+}
+
+// A formatted message as handed to sinks. The views point into the logger thread's
+// batch buffer and are only valid during VHLogSink::write.
+struct VHLogRecord {
+    VHLogLevel level;
+    std::chrono::system_clock::time_point timestamp;
+    // The message text alone.
+    std::string_view message;
+    // The complete line, newline included, in the sink's layout (see VHLogLayout).
+    std::string_view line;
+    // Deferred messages only: the format string, the type tags and the encoded bytes
+    // of the arguments (see VHLogFormat.h). argTypes is null when some argument type
+    // has no tag; format is empty for plain text messages.
+    std::string_view format;
+    const char* argTypes;
+    std::string_view args;
+    // Encoded structured fields, empty when there are none (see VHLogFields.h).
+    std::string_view fields;
+    // Number of the logging thread, assigned as threads first log.
+    std::uint32_t thread;
+};
@@ -0,0 +1,208 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded multi-producer ring buffer, drained by the logger thread.
+// Every slot carries its own sequence number (Vyukov's bounded queue), so producers
+// only contend on the tail index and never take a lock. Indexes and slots are padded
+// to a cache line to keep producers and the consumer from false sharing.
+template <typename T>
+class VHLogRingBuffer {
+public:
+    explicit VHLogRingBuffer(std::size_t capacity) {
+
+        std::size_t roundedCapacity = 2;
+        while (roundedCapacity < capacity) {
+            roundedCapacity <<= 1;
+        }
+        mask_ = roundedCapacity - 1;
+        slots_ = std::make_unique<Slot[]>(roundedCapacity);
+        for (std::size_t i = 0; i < roundedCapacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        tail_.store(0, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    VHLogRingBuffer(const VHLogRingBuffer&) = delete;
+    VHLogRingBuffer& operator=(const VHLogRingBuffer&) = delete;
+
+    // Safe to call from any number of threads. The item is left untouched when the
+    // buffer is full.
+    template <typename U>
+    bool tryPush(U&& item) {
+
+        std::size_t pos;
+        T* value = tryClaim(pos);
+        if (!value) {
+            return false;
+        }
+        *value = std::forward<U>(item);
+        publish(pos);
+        return true;
+    }
+
+    // Push in two steps: claims the next slot so the caller can fill it in place, and
+    // publish(position) hands it to the consumer. The consumer stops at a claimed slot
+    // until it is published. Returns null when the buffer is full.
+    T* tryClaim(std::size_t& position) {
+
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    position = pos;
+                    return &slot.value;
+                }
+            }
+            else if (diff < 0) {
+                return nullptr;
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(std::size_t position) {
+
+        slots_[position & mask_].sequence.store(position + 1, std::memory_order_release);
+    }
+
+    // Normally only the logger thread consumes, but popping is safe from any thread so
+    // producers can evict the oldest entry when the buffer is full.
+    bool tryPop(T& item) {
+
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(slot.value);
+                    slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool empty() const {
+
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        return slots_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_;
+};
+
+// Bounded single-producer/single-consumer ring buffer. Each side keeps a cached copy of
+// the other side's index, so in the common case a push or pop touches only cache lines
+// owned by the calling thread.
+template <typename T>
+class VHLogSpscBuffer {
+public:
+    explicit VHLogSpscBuffer(std::size_t capacity) {
+
+        std::size_t roundedCapacity = 2;
+        while (roundedCapacity < capacity) {
+            roundedCapacity <<= 1;
+        }
+        mask_ = roundedCapacity - 1;
+        slots_ = std::make_unique<T[]>(roundedCapacity);
+        tail_.store(0, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    VHLogSpscBuffer(const VHLogSpscBuffer&) = delete;
+    VHLogSpscBuffer& operator=(const VHLogSpscBuffer&) = delete;
+
+    // Producer side. The item is left untouched when the buffer is full.
+    template <typename U>
+    bool tryPush(U&& item) {
+
+        T* value = tryClaim();
+        if (!value) {
+            return false;
+        }
+        *value = std::forward<U>(item);
+        publish();
+        return true;
+    }
+
+    // Producer side, push in two steps: the slot tryClaim() returns can be filled in
+    // place until publish(). Claiming again before that returns the same slot.
+    T* tryClaim() {
+
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    void publish() {
+
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side.
+    bool tryPop(T& item) {
+
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    std::unique_ptr<T[]> slots_;
+    std::size_t mask_;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+    std::size_t cachedHead_ = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_;
+    std::size_t cachedTail_ = 0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "VHLogPattern.h"
+#include "VHLogRecord.h"
+
+// How the lines handed to a sink are rendered. The logger renders every layout in use
+// once per batch, sinks sharing a layout all get views into the same buffer.
+enum class VHLogLayout {
+    // [timestamp] [LEVEL] message
+    Text,
+    // {"time":"...","level":"LEVEL","message":"..."}, one object per line.
+    Json,
+    // time=... level=LEVEL msg=...
+    Logfmt,
+    // Given by a VHLogPattern, see setPattern(). Text while the sink has none.
+    Pattern
+};
+
+// Base class for log destinations. The logger thread calls write() once per drained
+// batch and flush() when it runs out of work or shuts down; both are only ever called
+// from the logger thread. Records below the sink's minimum level are still passed in,
+// implementations skip them with accepts().
+class VHLogSink {
+public:
+    virtual ~VHLogSink() = default;
+
+    virtual void write(std::span<const VHLogRecord> records) = 0;
+    virtual void flush() {}
+
+    // What the logger actually calls: write() plus the buffer every line points into.
+    // Sinks that use lines after returning, e.g. on another thread, can keep batchText
+    // alive instead of copying them; the logger then composes the next batch elsewhere.
+    virtual void writeShared(std::span<const VHLogRecord> records,
+                             const std::shared_ptr<const std::string>& batchText) {
+        (void)batchText;
+        write(records);
+    }
+
+    // Sinks returning false only read the raw fields of records. When no sink needs
+    // text the logger skips composing lines: records then have an empty line, and
+    // message is only set for plain text and for arguments without type tags. Raw
+    // sinks get the Text records, their line is also empty when no sink uses Text.
+    virtual bool needsText() const { return true; }
+
+    void setLayout(VHLogLayout layout) { layout_.store(layout, std::memory_order_relaxed); }
+    VHLogLayout layout() const { return layout_.load(std::memory_order_relaxed); }
+
+    // Switches to the Pattern layout. The pattern is parsed here. It is fixed once the
+    // sink is added to a logger, whose thread reads it without locking, so later calls
+    // are ignored.
+    void setPattern(std::string_view pattern) { setPattern(VHLogPattern(pattern)); }
+    void setPattern(VHLogPattern pattern) {
+
+        if (added_.load(std::memory_order_acquire)) {
+            return;
+        }
+        pattern_ = std::make_shared<const VHLogPattern>(std::move(pattern));
+        setLayout(VHLogLayout::Pattern);
+    }
+    const std::shared_ptr<const VHLogPattern>& pattern() const { return pattern_; }
+
+    void setMinimumLevel(VHLogLevel level) { minimumLevel_.store(level, std::memory_order_relaxed); }
+    bool accepts(VHLogLevel level) const { return level >= minimumLevel_.load(std::memory_order_relaxed); }
+
+protected:
+    // The logger composes a batch into one buffer, so accepted lines are usually
+    // adjacent in memory. Calls fn once per contiguous run of accepted lines.
+    template <typename Fn>
+    void forEachLineRun(std::span<const VHLogRecord> records, Fn&& fn) const {
+
+        const char* runStart = nullptr;
+        std::size_t runSize = 0;
+        for (const auto& record : records) {
+            if (!accepts(record.level)) {
+                continue;
+            }
+            if (runStart && runStart + runSize == record.line.data()) {
+                runSize += record.line.size();
+                continue;
+            }
+            if (runStart) {
+                fn(std::string_view(runStart, runSize));
+            }
+            runStart = record.line.data();
+            runSize = record.line.size();
+        }
+        if (runStart) {
+            fn(std::string_view(runStart, runSize));
+        }
+    }
+
+private:
+    friend class VHLogger;
+
+    std::atomic<VHLogLevel> minimumLevel_{VHLogLevel::DEBUGLV};
+    std::atomic<VHLogLayout> layout_{VHLogLayout::Text};
+    std::shared_ptr<const VHLogPattern> pattern_;
+    // Set by VHLogger::addSink(), pattern_ no longer changes from then on.
+    std::atomic<bool> added_{false};
+};
+
+class VHConsoleSink : public VHLogSink {
+public:
+    void write(std::span<const VHLogRecord> records) override;
+    void flush() override;
+};
+
+class VHNullSink : public VHLogSink {
+public:
+    void write(std::span<const VHLogRecord>) override {}
+};
@@ -0,0 +1,106 @@
+#pragma once
+#ifdef USE_ASIO
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "asio.hpp"
+#include "VHLogRingBuffer.h"
+#include "VHLogSink.h"
+
+// Sends every line to a TCP endpoint from its own asio I/O thread. Batches reach that
+// thread through a lock-free queue as views into the logger's own buffer, with at most
+// one wakeup pending, and whatever is queued when the previous write completes goes
+// out in one gathered write of up to MAX_SEND_BYTES.
+// While the endpoint is unreachable it reconnects with exponential backoff and jitter,
+// and the queue holds up to maxQueueBytes. Beyond that lines are appended to the
+// spoolPath file and replayed in order once the connection is back, ahead of anything
+// newer; without a spool file they are dropped and counted. Lines still queued when
+// the sink is destroyed go to the spool as well. A spool left by an earlier run is
+// replayed, so lines sent just before a crash or shutdown may arrive twice.
+class VHTCPSink : public VHLogSink {
+public:
+    static constexpr std::size_t MAX_SEND_BYTES = 256 * 1024;
+    static constexpr std::size_t DEFAULT_MAX_QUEUE_BYTES = 64 * 1024 * 1024;
+    static constexpr std::size_t PENDING_MESSAGES = 1024;
+    static constexpr std::chrono::milliseconds MIN_RECONNECT_DELAY{500};
+    static constexpr std::chrono::milliseconds MAX_RECONNECT_DELAY{30000};
+
+    VHTCPSink(const std::string& hostIpAddress, unsigned int hostPort,
+              std::size_t maxQueueBytes = DEFAULT_MAX_QUEUE_BYTES, const std::string& spoolPath = "");
+    ~VHTCPSink() override;
+
+    void write(std::span<const VHLogRecord> records) override;
+    void writeShared(std::span<const VHLogRecord> records,
+                     const std::shared_ptr<const std::string>& batchText) override;
+
+private:
+    // Bytes to send and the buffer keeping them alive. A queued message pins its whole
+    // owner, so the first one queued from each owner carries the owner's capacity in
+    // charge, counted against maxQueueBytes; the rest of that owner's run carry zero.
+    // The charge moves down the run as messages leave the queue.
+    struct TCPMessage {
+        std::shared_ptr<const std::string> owner;
+        std::string_view text;
+        std::size_t charge = 0;
+    };
+
+    void connectTCPSink();
+    void startReadingForDisconnects();
+    void scheduleReconnectTCPSink();
+    void sendNextTCPMessage();
+    void passToIOThread(TCPMessage message);
+    void wakeIOThread();
+    void drainPendingMessages();
+    void queueTCPMessage(TCPMessage message);
+    static std::size_t ownerCharge(const TCPMessage& message);
+    void releaseQueuedCharge(std::size_t charge, const std::shared_ptr<const std::string>& owner);
+    static std::vector<TCPMessage>::iterator skipSent(std::vector<TCPMessage>& messages, std::size_t bytesWritten);
+    bool spoolTCPMessage(std::string_view message);
+    bool loadSpoolChunk();
+    void spoolUnsentMessages();
+
+    asio::io_context ioContext_;
+    std::unique_ptr<asio::steady_timer> reconnectTimer_;
+    std::string hostIpAddress_;
+    unsigned int hostPort_;
+    std::string readBuffer_;
+    std::atomic<bool> socketConnected_;
+    std::atomic<bool> shutdownSocket_{false};
+    asio::ip::tcp::socket socket_;
+    std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> workGuard_;
+    std::thread ioThread_;
+    mutable std::mutex socketMutex_;
+    std::deque<TCPMessage> tcpMessageQueue_;
+    // Logger thread to I/O thread.
+    VHLogSpscBuffer<TCPMessage> pendingMessages_{PENDING_MESSAGES};
+    std::atomic<bool> drainScheduled_{false};
+    // The write in flight, only touched on the I/O thread.
+    std::vector<TCPMessage> sendingMessages_;
+    std::vector<asio::const_buffer> sendBuffers_;
+    bool tcpIsSending_;
+
+    // Everything below is only touched on the I/O thread.
+    std::size_t maxQueueBytes_;
+    std::size_t queuedBytes_;
+    std::string spoolPath_;
+    std::ofstream spoolOut_;
+    std::uint64_t spoolReadOffset_;
+    // Set while the spool holds lines not sent yet; new lines go there too, behind them.
+    bool spooling_;
+    std::uint64_t droppedLines_;
+    unsigned int reconnectAttempts_;
+    bool reconnectPending_;
+    std::minstd_rand random_;
+};
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VHLogFileSink.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define VHLOG_HAS_IO_URING 1
+#endif
+
+// Linux file sink that hands its full buffers to io_uring instead of blocking in
+// write(). bufferCount buffers are registered with the ring and recycled as their
+// writes complete, so the logger thread keeps formatting while I/O is in flight; it
+// only waits when every buffer is still being written. Every syncInterval an
+// fdatasync is queued behind the pending writes (zero disables it).
+// Where io_uring is unavailable (other platforms, old kernels, seccomp) it behaves
+// exactly like VHFileSink.
+class VHUringFileSink : public VHFileSink {
+public:
+    static constexpr std::size_t DEFAULT_BUFFER_COUNT = 4;
+
+    explicit VHUringFileSink(const std::string& basePathAndName = "", std::size_t maxSize = 1024*1024,
+                             std::size_t bufferSize = DEFAULT_BUFFER_SIZE,
+                             std::size_t bufferCount = DEFAULT_BUFFER_COUNT,
+                             std::chrono::milliseconds syncInterval = std::chrono::milliseconds(1000));
+    ~VHUringFileSink() override;
+
+    // False when the sink fell back to plain write() calls.
+    bool usingIoUring() const { return ring_ != nullptr; }
+
+protected:
+    void writeBuffer(std::string_view extra = {}) override;
+    void fileOpened() override;
+    void fileClosing() override;
+    void syncFile() override;
+
+private:
+    struct Ring;
+    struct Slot {
+        std::string data;
+        std::uint64_t offset = 0;
+        bool inFlight = false;
+    };
+
+    bool initRing(std::size_t bufferCount);
+    Slot& acquireSlot();
+    void submitWrite(Slot& slot, std::size_t slotIndex);
+    void submitSync();
+    void reapCompletions(unsigned waitFor);
+    void drain();
+    int registeredIndex(const char* data) const;
+
+    std::unique_ptr<Ring> ring_;
+    std::vector<Slot> slots_;
+    std::vector<const char*> registeredData_;
+    std::uint64_t nextOffset_;
+    std::size_t pending_;
+    std::chrono::milliseconds syncInterval_;
+    std::chrono::steady_clock::time_point lastSync_;
+};
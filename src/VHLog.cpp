@@ -1,137 +1,105 @@
 #include "VHLog.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <ctime>
-#include <iostream>
 #include <mutex>
 #include <format>
-#include <print>
+#include <iterator>
 #include <string>
 
-#ifdef USE_ASIO
-VHLogger::VHLogger(bool debugEnvironment, std::size_t batchSize) : 
-    socket_(ioContext_),
-    basePathAndName_("") {
+namespace {
 
-    workerRunning_ = true;
-    batchSize_ = batchSize;
-    tcpIsSending_ = false;
-    unflushedBytes_ = 0;
-    debugEnvironment_ = debugEnvironment;
-    sinkTypes_.clear();
-    socketConnected_ = false;
-    shutdownSocket_.store(false, std::memory_order_release);  
-    reconnectTimer_ = std::make_unique<asio::steady_timer>(ioContext_);
-    vhlogShutdown_ = false;
+std::atomic<std::uint64_t> nextLoggerId{1};
 
-    workGuard_ = std::make_unique<asio::executor_work_guard<asio::io_context::executor_type>>(
-        asio::make_work_guard(ioContext_)
-    );
-    loggerThread_ = std::thread(&VHLogger::loggerWorker, this);
-    ioThread_ = std::thread([this] { 
-        ioContext_.run(); 
-    });
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-}
+// Buffers this thread registered with any logger, keyed by logger id rather than
+// address so a new logger reusing a dead one's memory is never handed a stale buffer.
+struct VHLogThreadRegistry {
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<VHLogThreadBuffer>>> entries;
+    std::uint64_t lastLoggerId = 0;
+    VHLogThreadBuffer* lastBuffer = nullptr;
 
-void VHLogger::shutdown() {
-    
-    workerRunning_ = false;
-    condVar_.notify_all();
-    
-    if (loggerThread_.joinable()) {
-        loggerThread_.join();
-    }
-    
-    std::deque<std::pair<VHLogLevel, std::string>> remainingMessages;
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        remainingMessages.swap(logMessageQueue_);
-    }
-    
-    for (auto& [level, message] : remainingMessages) {
-        if (!message.empty()) {
-            writeToDestination(level, message);
-        }
-    }
-    
-    shutdownSocket_.store(true, std::memory_order_release);
-    if (reconnectTimer_) {
-        reconnectTimer_->cancel();
-    }
-    
-    std::error_code ec;
-    socket_.cancel(ec);
-    
-    ioContext_.restart();
-    while (ioContext_.poll_one() > 0) {}
-    
-    {
-        std::lock_guard<std::mutex> lock(socketMutex_);
-        tcpMessageQueue_.clear();
-        tcpIsSending_ = false;
-    }
-    
-    {
-        std::lock_guard<std::mutex> lock(socketMutex_);
-        if (socket_.is_open()) {
-            socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
-            socket_.close(ec);
+    ~VHLogThreadRegistry() {
+        for (auto& [loggerId, buffer] : entries) {
+            buffer->producerExited.store(true, std::memory_order_release);
         }
-        socketConnected_ = false;
     }
-    
-    ioContext_.stop();
-    
-    if (workGuard_) {
-        workGuard_.reset();
-    }
-    
-    if (ioThread_.joinable()) { 
-        ioThread_.join();
+};
+
+thread_local VHLogThreadRegistry threadRegistry;
+
+std::atomic<std::uint32_t> nextThreadNumber{1};
+
+std::uint32_t threadNumber() {
+
+    thread_local std::uint32_t number = nextThreadNumber.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+// The layout the logger renders for sink. Raw sinks and Pattern sinks without a
+// pattern get the Text records.
+VHLogLayout renderedLayout(const VHLogSink& sink) {
+
+    if (!sink.needsText()) {
+        return VHLogLayout::Text;
     }
-    
-    ioContext_.restart();
-    while (ioContext_.poll_one() > 0) {}
-    
-    if (file_ && file_.is_open()) {
-        file_.flush();
-        file_.close();
+    VHLogLayout layout = sink.layout();
+    return layout == VHLogLayout::Pattern && !sink.pattern() ? VHLogLayout::Text : layout;
+}
+
+// A sink kept the previous batch's buffer, compose the next one into a new buffer.
+// It starts small: sized like the one held, a sink queueing every batch would pin the
+// high-water capacity each time.
+std::string& reuseBatchBuffer(std::shared_ptr<std::string>& buffer) {
+
+    if (!buffer || buffer.use_count() > 1) {
+        buffer = std::make_shared<std::string>();
     }
-    
-    vhlogShutdown_ = true;
+    buffer->clear();
+    return *buffer;
 }
 
-#else
-VHLogger::VHLogger(bool debugEnvironment, std::size_t batchSize) : 
-    basePathAndName_("") {
+}
+
+VHLogger::VHLogger(bool debugEnvironment, std::size_t batchSize, std::size_t queueCapacity) : 
+    logMessageQueue_(queueCapacity),
+    loggerId_(nextLoggerId.fetch_add(1, std::memory_order_relaxed)),
+    timeZone_(std::chrono::current_zone()) {
+
     workerRunning_ = true;
     batchSize_ = batchSize;
-    unflushedBytes_ = 0;
-    debugEnvironment_ = debugEnvironment;
-    sinkTypes_.clear();
+    minimumLevel_ = debugEnvironment ? VHLogLevel::DEBUGLV : VHLogLevel::INFOLV;
+    vhlogShutdown_ = false;
+    // Room for any date, so refreshing the cached timestamps once a second does not allocate.
+    for (TimestampCache* cache : {&textTimestamp_, &isoTimestamp_}) {
+        cache->prefix.reserve(TimestampCache::CAPACITY);
+        cache->suffix.reserve(TimestampCache::CAPACITY);
+    }
     loggerThread_ = std::thread(&VHLogger::loggerWorker, this);
 }
 
 void VHLogger::shutdown() {
 
     workerRunning_ = false;
-    
-    condVar_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        condVar_.notify_all();
+    }
     
     if (loggerThread_.joinable()) {
         loggerThread_.join();
     }
 
-    if (file_ && file_.is_open()) {
-        file_.flush();
-        file_.close();
+    // Sinks release their files and sockets when the last reference goes away.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sinks_.clear();
     }
     vhlogShutdown_ = true;
 }
 
-#endif
-
 VHLogger::~VHLogger() {
 
     if (!vhlogShutdown_) {
@@ -141,419 +109,684 @@ VHLogger::~VHLogger() {
 
 void VHLogger::loggerWorker() {
 
-    std::vector<std::pair<VHLogLevel, std::string>> batch;
+    std::vector<VHLogMessage> batch;
+    batch.reserve(batchSize_);
+    int idleSpins = 0;
     
     while (true) {
-        std::unique_lock<std::mutex> lock(queueMutex_);
-        
-        condVar_.wait(lock, [this]() {
-            return !logMessageQueue_.empty() || !workerRunning_;
-        });
-        
-        if (!workerRunning_ && logMessageQueue_.empty()) {
-            break;
+        if (clock_.shouldRecalibrate(VHLogClock::ticks())) {
+            clock_.recalibrate();
+            reportDroppedMessages();
         }
+        collectBatch(batch);
         
-        const size_t available = logMessageQueue_.size();
-        const size_t batch_size = std::min(available, static_cast<size_t>(batchSize_));
-        
-        batch.reserve(batch_size);
-        
-        for (size_t i = 0; i < batch_size; ++i) {
-            batch.emplace_back(std::move(logMessageQueue_.front()));
-            logMessageQueue_.pop_front();
+        if (!batch.empty()) {
+            writeToDestination(batch);
+            batch.clear();
+            idleSpins = 0;
+            continue;
         }
         
-        lock.unlock(); 
+        if (!workerRunning_.load(std::memory_order_acquire)) {
+            break;
+        }
         
-        for (auto& [level, message] : batch) {
-            if (!message.empty()) { 
-                writeToDestination(level, message);
-            }
+        if (idleSpins < WORKER_SPIN_ITERATIONS) {
+            ++idleSpins;
+            std::this_thread::yield();
+            continue;
         }
+        flushSinks();
         
-        batch.clear();
+        // Park. The seq_cst fence pairs with the one in notifyWorkerIfParked(): either the
+        // producer sees workerParked_ and notifies, or we see its message before going to sleep.
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        workerParked_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condVar_.wait(lock, [this]() {
+            return hasPendingMessages() || !workerRunning_.load(std::memory_order_acquire);
+        });
+        workerParked_.store(false, std::memory_order_relaxed);
+        idleSpins = 0;
     }
     
-    std::unique_lock<std::mutex> lock(queueMutex_);
-    while (!logMessageQueue_.empty()) {
-        auto& [level, message] = logMessageQueue_.front();
-        if (!message.empty()) {
-            writeToDestination(level, message);
+    do {
+        batch.clear();
+        collectBatch(batch);
+        writeToDestination(batch);
+    } while (!batch.empty());
+    reportDroppedMessages();
+    flushSinks();
+    workerSinks_.clear();
+
+    std::lock_guard<std::mutex> lock(threadBuffersMutex_);
+    for (auto& buffer : threadBuffers_) {
+        buffer->consumerClosed.store(true, std::memory_order_release);
+    }
+    threadBuffers_.clear();
+    workerThreadBuffers_.clear();
+}
+
+void VHLogger::collectBatch(std::vector<VHLogMessage>& batch) {
+
+    if (threadBuffersVersion_.load(std::memory_order_acquire) != workerThreadBuffersVersion_) {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex_);
+        workerThreadBuffers_ = threadBuffers_;
+        workerThreadBuffersVersion_ = threadBuffersVersion_.load(std::memory_order_relaxed);
+    }
+
+    VHLogMessage entry;
+    for (std::size_t i = 0; i < batchSize_ && logMessageQueue_.tryPop(entry); ++i) {
+        batch.emplace_back(std::move(entry));
+    }
+
+    bool retireBuffers = false;
+    const std::size_t bufferCount = workerThreadBuffers_.size();
+    for (std::size_t n = 0; n < bufferCount; ++n) {
+        auto& buffer = workerThreadBuffers_[(nextThreadBuffer_ + n) % bufferCount];
+        // Read producerExited before draining: once it is set every push of that
+        // thread is visible, so an empty buffer here is empty for good.
+        bool exited = buffer->producerExited.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < batchSize_ && buffer->queue.tryPop(entry); ++i) {
+            batch.emplace_back(std::move(entry));
+        }
+        if (exited && buffer->queue.empty()) {
+            retireBuffers = true;
         }
-        logMessageQueue_.pop_front();
+    }
+    if (bufferCount > 0) {
+        nextThreadBuffer_ = (nextThreadBuffer_ + 1) % bufferCount;
+    }
+
+    if (orderByTimestamp_.load(std::memory_order_relaxed) && batch.size() > 1) {
+        std::stable_sort(batch.begin(), batch.end(), [](const VHLogMessage& a, const VHLogMessage& b) {
+            return a.timestamp < b.timestamp;
+        });
+    }
+
+    if (retireBuffers) {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex_);
+        std::erase_if(threadBuffers_, [](const std::shared_ptr<VHLogThreadBuffer>& buffer) {
+            return buffer->producerExited.load(std::memory_order_acquire) && buffer->queue.empty();
+        });
+        threadBuffersVersion_.fetch_add(1, std::memory_order_release);
     }
 }
 
-void VHLogger::addConsoleSink() {
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    appendNewSink(VHLogSinkType::ConsoleSink);
+bool VHLogger::hasPendingMessages() {
+
+    if (!logMessageQueue_.empty()) {
+        return true;
+    }
+    if (threadBuffersVersion_.load(std::memory_order_acquire) != workerThreadBuffersVersion_) {
+        return true;
+    }
+    for (const auto& buffer : workerThreadBuffers_) {
+        if (!buffer->queue.empty()) {
+            return true;
+        }
+    }
+    return false;
 }
 
+void VHLogger::notifyWorker() {
 
-void VHLogger::addFileSink(const std::string& basePathAndName, std::size_t maxSize) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    condVar_.notify_one();
+}
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    appendNewSink(VHLogSinkType::FileSink);
-    
-    if (basePathAndName_ == "") {
-        basePathAndName_ = basePathAndName;
+VHLogThreadBuffer& VHLogger::localThreadBuffer() {
+
+    if (threadRegistry.lastLoggerId == loggerId_) {
+        return *threadRegistry.lastBuffer;
     }
-    
-    if (file_ && file_.is_open()) {
-        file_.close();
+
+    auto& entries = threadRegistry.entries;
+    auto found = std::find_if(entries.begin(), entries.end(), [this](const auto& entry) {
+        return entry.first == loggerId_;
+    });
+    if (found == entries.end()) {
+        std::erase_if(entries, [](const auto& entry) {
+            return entry.second->consumerClosed.load(std::memory_order_acquire);
+        });
+        auto buffer = std::make_shared<VHLogThreadBuffer>(perThreadCapacity_.load(std::memory_order_relaxed));
+        {
+            std::lock_guard<std::mutex> lock(threadBuffersMutex_);
+            threadBuffers_.push_back(buffer);
+            threadBuffersVersion_.fetch_add(1, std::memory_order_release);
+        }
+        entries.emplace_back(loggerId_, std::move(buffer));
+        found = entries.end() - 1;
     }
-    
-    maxSize_ = maxSize;
-    currentSize_ = 0;
-    
-    auto now = std::chrono::system_clock::now();
-    auto nowSec = std::chrono::floor<std::chrono::seconds>(now);
-    auto zt = std::chrono::zoned_time(std::chrono::current_zone(), nowSec);
-    currentDate_ = std::format("{:%Y-%m-%d}", zt);
-    std::string fileName = std::format("{}_{:%Y-%m-%d_%H-%M:%S}.log", basePathAndName_, zt);
 
+    threadRegistry.lastLoggerId = loggerId_;
+    threadRegistry.lastBuffer = found->second.get();
+    return *threadRegistry.lastBuffer;
+}
 
-    file_.open(fileName, std::ios::app);
-    if (!file_) {
-        std::println("Failed to open/create log file: {}", fileName);
-    }
+void VHLogger::enablePerThreadBuffers(bool orderByTimestamp, std::size_t perThreadCapacity) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    perThreadCapacity_ = perThreadCapacity;
+    orderByTimestamp_ = orderByTimestamp;
+    perThreadBuffers_ = true;
 }
 
-void VHLogger::rotateFileSink() {
-   
-    std::lock_guard<std::mutex> lock(fileMutex_);
-    if (file_ && file_.is_open()) {
-        file_.flush();
-        file_.close();
+void VHLogger::addSink(std::shared_ptr<VHLogSink> sink) {
+
+    if (!sink) {
+        return;
     }
+    sink->added_.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sinks_.push_back(std::move(sink));
+    sinksVersion_.fetch_add(1, std::memory_order_release);
+}
 
-    currentSize_ = 0;
-    unflushedBytes_ = 0;
+void VHLogger::addConsoleSink() {
+    
+    addSink(std::make_shared<VHConsoleSink>());
+}
 
-    auto now = std::chrono::system_clock::now();
-    auto nowSec = std::chrono::floor<std::chrono::seconds>(now);
-    auto zt = std::chrono::zoned_time(std::chrono::current_zone(), nowSec);
-    currentDate_ = std::format("{:%Y-%m-%d}", zt);
-    std::string fileName = std::format("{}_{:%Y-%m-%d_%H-%M:%S}.log", basePathAndName_, zt);
+void VHLogger::addFileSink(const std::string& basePathAndName, std::size_t maxSize, std::size_t bufferSize) {
 
-    file_.open(fileName, std::ios::app);
-    if (!file_) {
-        std::println("Failed to open/create log file: {}", fileName);
-    }
+    addSink(std::make_shared<VHFileSink>(basePathAndName, maxSize, bufferSize));
 }
 
 void VHLogger::addNullSink() {
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    appendNewSink(VHLogSinkType::NullSink);
+    addSink(std::make_shared<VHNullSink>());
 }
 
 void VHLogger::addTCPSink(const std::string& hostIpAddress, unsigned int hostPort) {
 
 #ifdef USE_ASIO
-    std::lock_guard<std::mutex> lock(mutex_);
-    appendNewSink(VHLogSinkType::TCPSink);
-    hostIpAddress_ = hostIpAddress;
-    hostPort_ = hostPort;
-    connectTCPSink();
+    addSink(std::make_shared<VHTCPSink>(hostIpAddress, hostPort));
 #else
-    writeToDestination(VHLogLevel::WARNINGLV, "You are trying to use TCP sink, but you have compiled without asio.");
+    log(VHLogLevel::WARNINGLV, "You are trying to use TCP sink, but you have compiled without asio.");
 #endif
 }
 
-void VHLogger::log(VHLogLevel level, const std::string& message) {
-    
-    if (level != VHLogLevel::DEBUGLV || debugEnvironment_) {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        std::pair<VHLogLevel, std::string> received;
-        logMessageQueue_.emplace_back(level, std::move(message));
-        condVar_.notify_one();
+void VHLogger::log(VHLogLevel level, std::string_view message) {
+
+    if (auto slot = reserve(level, message.size())) {
+        std::memcpy(slot.data(), message.data(), message.size());
+        commit(slot);
     }
 }
 
-void VHLogger::writeToDestination(VHLogLevel level, const std::string& message) {
-   
-    bool needsTcp = false;
-    auto now = std::chrono::system_clock::now();
-    auto nowSec = std::chrono::floor<std::chrono::seconds>(now);
-    auto zt = std::chrono::zoned_time(std::chrono::current_zone(), nowSec);
-
-    static constexpr const char* levels[] = {
-        "DEBUG", "INFO", "WARNING", "ERROR", "FATAL", "UNKNOWN"
+void VHLogger::log(VHLogLevel level, std::string&& message) {
+
+    if (message.size() <= VHLogPayload::INLINE_CAPACITY) {
+        log(level, std::string_view(message));
+        return;
+    }
+    if (shouldLog(level)) {
+        VHLogMessage entry;
+        entry.level = level;
+        entry.message.assign(std::move(message));
+        enqueue(std::move(entry));
+    }
+}
+
+void VHLogger::log(VHLogLevel level, std::string_view message, std::initializer_list<VHLogField> fields) {
+
+    std::size_t fieldsSize = vhlogFieldsSize(fields);
+    if (auto slot = reserve(level, message.size() + fieldsSize)) {
+        std::memcpy(slot.data(), message.data(), message.size());
+        vhlogEncodeFields(slot.data() + message.size(), fields);
+        slot.slot_->fieldsSize = static_cast<std::uint32_t>(fieldsSize);
+        commit(slot);
+    }
+}
+
+VHLogReservation VHLogger::reserve(VHLogLevel level, std::size_t size) {
+
+    VHLogReservation reservation;
+    if (!shouldLog(level)) {
+        return reservation;
+    }
+    VHLogThreadBuffer* buffer = perThreadBuffers_.load(std::memory_order_relaxed) ? &localThreadBuffer() : nullptr;
+    VHLogMessage* slot = nullptr;
+    std::size_t position = 0;
+    auto tryClaim = [this, buffer, &slot, &position]() {
+        slot = buffer ? buffer->queue.tryClaim() : logMessageQueue_.tryClaim(position);
+        return slot != nullptr;
     };
+    if (!waitForSlot(level, buffer, tryClaim)) {
+        notifyWorkerIfParked();
+        return reservation;
+    }
+
+    slot->level = level;
+    slot->formatter = nullptr;
+    slot->format = {};
+    slot->argTypes = nullptr;
+    slot->timestamp = VHLogClock::ticks();
+    slot->fieldsSize = 0;
+    slot->thread = threadNumber();
+    slot->message.resize(size);
+    reservation.logger_ = this;
+    reservation.slot_ = slot;
+    reservation.buffer_ = buffer;
+    reservation.position_ = position;
+    return reservation;
+}
 
-    const char* levelString = levels[std::min(static_cast<int>(level), 5)];
-    std::string composedMessage = std::format("[{:%Y-%m-%d_%H-%M:%S}] [{}] {}\n",
-                                             zt, 
-                                             levelString, 
-                                             message);
-    
-    for (const auto& sinkType : sinkTypes_) {
-        switch ((int)sinkType) {
-            case (int)VHLogSinkType::FileSink:
-                {
-                    if (file_ && file_.is_open()) {
-                        file_ << composedMessage;
-                        currentSize_ += composedMessage.size();
-                        unflushedBytes_ += composedMessage.size();
-                        bool bShouldFlush = false;
-                        if (unflushedBytes_ >= FLUSH_THRESHOLD) {
-                            bShouldFlush = true;
-                        }
-                        else if (level == VHLogLevel::FATALLV || level == VHLogLevel::ERRORLV) {
-                            bShouldFlush = true;
-                        }
-                        else if (shouldRotate(composedMessage.size())) {
-                            bShouldFlush = true;
-                            rotateFileSink();
-                        }
-                        if (bShouldFlush) {
-                            file_.flush();
-                            unflushedBytes_ = 0;
-                        }
-                    }
-                }
-                break;
-            case (int)VHLogSinkType::ConsoleSink:
-                std::print("{}", composedMessage);
-                break;
-            case (int)VHLogSinkType::NullSink:
-                break;
-            case (int)VHLogSinkType::TCPSink:
-                needsTcp = true;
-                break;
-        }
+void VHLogger::commit(VHLogReservation& reservation) {
+
+    if (reservation) {
+        publish(reservation);
     }
-#ifdef USE_ASIO
-    if (needsTcp) {
-        if (!shutdownSocket_) {
-            std::string tcpMessage = composedMessage;
-            asio::post(ioContext_, [this, msg = std::move(tcpMessage) ]() mutable {
-                if (!shutdownSocket_) {
-                    tcpMessageQueue_.push_back(std::move(msg));
-                    if (!tcpIsSending_) {
-                        sendNextTCPMessage();
-                    }
-                }
-            });
-        }
+}
+
+void VHLogger::publish(VHLogReservation& reservation) {
+
+    if (reservation.buffer_) {
+        reservation.buffer_->queue.publish();
     }
-#endif
+    else {
+        logMessageQueue_.publish(reservation.position_);
+    }
+    reservation.slot_ = nullptr;
+    notifyWorkerIfParked();
 }
 
-bool VHLogger::shouldRotate(std::size_t messageSize) {
-    if (currentSize_ + messageSize > maxSize_) {
+void VHLogger::enqueue(VHLogMessage&& entry) {
+
+    entry.timestamp = VHLogClock::ticks();
+    entry.thread = threadNumber();
+    VHLogThreadBuffer* buffer = perThreadBuffers_.load(std::memory_order_relaxed) ? &localThreadBuffer() : nullptr;
+    auto tryPush = [this, buffer, &entry]() {
+        return buffer ? buffer->queue.tryPush(std::move(entry)) : logMessageQueue_.tryPush(std::move(entry));
+    };
+    waitForSlot(entry.level, buffer, tryPush);
+    notifyWorkerIfParked();
+}
+
+// Applies the overflow policy while tryFn cannot find room in buffer, or in the shared
+// queue when it is null. False when the message is to be dropped.
+template <typename TryFn>
+bool VHLogger::waitForSlot(VHLogLevel level, VHLogThreadBuffer* buffer, TryFn&& tryFn) {
+
+    if (tryFn()) {
         return true;
     }
-    auto now = std::chrono::system_clock::now();
-    std::string currentDate = std::format("{:%Y-%m-%d}", now);
-    
-    if (currentDate != currentDate_) {
-        return true;
+    VHLogOverflowPolicy policy = overflowPolicy_.load(std::memory_order_relaxed);
+    if (policy == VHLogOverflowPolicy::DropBelowLevel) {
+        policy = level < dropBelowLevel_.load(std::memory_order_relaxed) ?
+            VHLogOverflowPolicy::DropNewest : VHLogOverflowPolicy::Block;
+    }
+    // A per-thread buffer only has the worker as consumer, so there is nothing the
+    // producer may evict from it.
+    if (policy == VHLogOverflowPolicy::DropOldest && buffer) {
+        policy = VHLogOverflowPolicy::DropNewest;
+    }
+
+    switch (policy) {
+        case VHLogOverflowPolicy::Block:
+            do {
+                // Nobody drains the queue once the logger shuts down, waiting would never end.
+                if (!workerRunning_.load(std::memory_order_acquire) ||
+                    (buffer && buffer->consumerClosed.load(std::memory_order_acquire))) {
+                    droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                // Only take queueMutex_ when the worker sleeps, it is draining otherwise.
+                notifyWorkerIfParked();
+                std::this_thread::yield();
+            } while (!tryFn());
+            return true;
+        case VHLogOverflowPolicy::DropOldest:
+            {
+                VHLogMessage evicted;
+                do {
+                    if (logMessageQueue_.tryPop(evicted)) {
+                        droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } while (!tryFn());
+            }
+            return true;
+        default:
+            droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+            return false;
     }
-    return false;
 }
 
-#ifdef USE_ASIO
-void VHLogger::connectTCPSink() {
-    if (shutdownSocket_) {
-        return;
+void VHLogger::notifyWorkerIfParked() {
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (workerParked_.load(std::memory_order_relaxed)) {
+        notifyWorker();
     }
+}
+
+VHLogReservation::VHLogReservation(VHLogReservation&& other) noexcept :
+    logger_(other.logger_),
+    slot_(std::exchange(other.slot_, nullptr)),
+    buffer_(other.buffer_),
+    position_(other.position_) {
+}
 
-    if (reconnectTimer_) {
-        reconnectTimer_->cancel();
+VHLogReservation& VHLogReservation::operator=(VHLogReservation&& other) noexcept {
+
+    if (this != &other) {
+        release();
+        logger_ = other.logger_;
+        slot_ = std::exchange(other.slot_, nullptr);
+        buffer_ = other.buffer_;
+        position_ = other.position_;
     }
+    return *this;
+}
+
+VHLogReservation::~VHLogReservation() {
+
+    release();
+}
 
-    std::error_code ec;
-    asio::error_code res;
+void VHLogReservation::release() {
 
-    if (socket_.is_open()) {
-        res = socket_.close(ec);
+    // The slot cannot be given back, hand it over empty so the worker skips it.
+    if (slot_) {
+        slot_->message.truncate(0);
+        logger_->publish(*this);
     }
-    
-    {
-        std::lock_guard<std::mutex> lock(socketMutex_);
-        socketConnected_ = false;
+}
+
+void VHLogger::setOverflowPolicy(VHLogOverflowPolicy policy, VHLogLevel dropBelowLevel) {
+
+    dropBelowLevel_.store(dropBelowLevel, std::memory_order_relaxed);
+    overflowPolicy_.store(policy, std::memory_order_relaxed);
+}
+
+void VHLogger::reportDroppedMessages() {
+
+    std::uint64_t dropped = droppedMessages_.load(std::memory_order_relaxed);
+    if (dropped != reportedDroppedMessages_) {
+        writeToDestination(VHLogLevel::WARNINGLV,
+                           std::format("{} messages dropped", dropped - reportedDroppedMessages_));
+        reportedDroppedMessages_ = dropped;
     }
-    
-    tcpIsSending_ = false;
-    
-    asio::ip::tcp::resolver resolver(ioContext_);
-    auto endpoints = resolver.resolve(hostIpAddress_, std::to_string(hostPort_), ec);
-    
-    if (ec) {
-        if (!shutdownSocket_) {
-            scheduleReconnectTCPSink();
+}
+
+void VHLogger::writeToDestination(const std::vector<VHLogMessage>& batch) {
+
+    if (sinksVersion_.load(std::memory_order_acquire) != workerSinksVersion_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        workerSinks_ = sinks_;
+        workerSinksVersion_ = sinksVersion_.load(std::memory_order_relaxed);
+
+        std::vector<PatternBatch> patternBatches;
+        for (const auto& sink : workerSinks_) {
+            const auto& pattern = sink->pattern();
+            auto samePattern = [&pattern](const auto& entry) { return entry.pattern->pattern() == pattern->pattern(); };
+            if (!pattern || std::any_of(patternBatches.begin(), patternBatches.end(), samePattern)) {
+                continue;
+            }
+            auto kept = std::find_if(patternBatches_.begin(), patternBatches_.end(), samePattern);
+            patternBatches.push_back(kept != patternBatches_.end() ? std::move(*kept) : PatternBatch{pattern, {}});
         }
+        patternBatches_ = std::move(patternBatches);
+    }
+    bool composeText = false;
+    bool composeJson = false;
+    bool composeLogfmt = false;
+    bool formatMessages = false;
+    for (const auto& sink : workerSinks_) {
+        VHLogLayout layout = renderedLayout(*sink);
+        composeText |= layout == VHLogLayout::Text && sink->needsText();
+        composeJson |= layout == VHLogLayout::Json;
+        composeLogfmt |= layout == VHLogLayout::Logfmt;
+        formatMessages |= sink->needsText();
+    }
+    for (auto& entry : patternBatches_) {
+        entry.rendered = false;
+    }
+
+    reuseBatchBuffer(batchText_);
+    batchOffsets_.clear();
+    batchRecords_.clear();
+    for (const auto& entry : batch) {
+        appendRecord(entry, composeText, formatMessages);
+    }
+    if (batchOffsets_.empty()) {
         return;
     }
-    
-    asio::async_connect(socket_, endpoints, 
-        [this](std::error_code ec, asio::ip::tcp::endpoint endpoint) {
-            if (shutdownSocket_.load(std::memory_order_acquire)) { 
-                return;
-            }
-            if (!ec) {
-                std::lock_guard<std::mutex> lock(socketMutex_);
-                socketConnected_ = true;
-                
-                asio::socket_base::keep_alive option(true);
-                socket_.set_option(option);
-                
-                startReadingForDisconnects();
-                
-                asio::post(ioContext_, [this]() {
-                    if (!tcpMessageQueue_.empty() && !tcpIsSending_) {
-                        sendNextTCPMessage();
-                    }
-                });
-            } 
-            else {
-                if (!shutdownSocket_) {
-                    scheduleReconnectTCPSink();
-                }
+
+    // batchText_ no longer grows, views into it stay valid until the next batch.
+    std::string_view text(*batchText_);
+    std::size_t index = 0;
+    for (const auto& entry : batch) {
+        if (!entry.formatter && entry.message.empty()) {
+            continue;
+        }
+        const RecordOffsets& offsets = batchOffsets_[index++];
+        batchRecords_.push_back(VHLogRecord{
+            entry.level,
+            clock_.toSystemTime(entry.timestamp),
+            text.substr(offsets.messageStart, offsets.messageEnd - offsets.messageStart),
+            text.substr(offsets.lineStart, offsets.lineEnd - offsets.lineStart),
+            entry.formatter ? entry.format : std::string_view(),
+            entry.formatter ? entry.argTypes : nullptr,
+            entry.formatter ? entry.message.view() : std::string_view(),
+            entry.message.view().substr(entry.message.size() - entry.fieldsSize),
+            entry.thread
+        });
+    }
+    if (composeJson) {
+        renderLayout(VHLogLayout::Json, jsonBatch_);
+    }
+    if (composeLogfmt) {
+        renderLayout(VHLogLayout::Logfmt, logfmtBatch_);
+    }
+
+    std::shared_ptr<const std::string> sharedText = batchText_;
+    std::shared_ptr<const std::string> sharedJson = jsonBatch_.text;
+    std::shared_ptr<const std::string> sharedLogfmt = logfmtBatch_.text;
+    for (const auto& sink : workerSinks_) {
+        VHLogLayout layout = renderedLayout(*sink);
+        if (layout == VHLogLayout::Pattern) {
+            // Sinks cannot change their pattern once added, so the refresh above made an entry.
+            auto entry = std::find_if(patternBatches_.begin(), patternBatches_.end(), [&sink](const auto& entry) {
+                return entry.pattern->pattern() == sink->pattern()->pattern();
+            });
+            if (!entry->rendered) {
+                renderLayout(VHLogLayout::Pattern, entry->batch, entry->pattern.get());
+                entry->rendered = true;
             }
+            sink->writeShared(entry->batch.records, entry->batch.text);
+        }
+        else if (layout == VHLogLayout::Json) {
+            sink->writeShared(jsonBatch_.records, sharedJson);
+        }
+        else if (layout == VHLogLayout::Logfmt) {
+            sink->writeShared(logfmtBatch_.records, sharedLogfmt);
         }
-    );
+        else {
+            sink->writeShared(batchRecords_, sharedText);
+        }
+    }
 }
 
-void VHLogger::sendNextTCPMessage() {
-    if (shutdownSocket_.load(std::memory_order_acquire)) {
-        std::lock_guard<std::mutex> lock(socketMutex_);
-        tcpIsSending_ = false;
-        return;
+// Renders batchRecords_ in layout. Messages are taken from the Text pass, so deferred
+// arguments are still formatted only once.
+void VHLogger::renderLayout(VHLogLayout layout, LayoutBatch& target, const VHLogPattern* pattern) {
+
+    std::string& out = reuseBatchBuffer(target.text);
+    target.offsets.clear();
+    target.records.clear();
+    for (const auto& record : batchRecords_) {
+        target.offsets.push_back(out.size());
+        if (layout == VHLogLayout::Pattern) {
+            pattern->format(out, record, localTimeFields(record.timestamp));
+        }
+        else if (layout == VHLogLayout::Json) {
+            out += "{\"time\":\"";
+            appendTimestamp(out, record.timestamp, layout);
+            out += "\",\"level\":\"";
+            out += vhlogLevelName(record.level);
+            out += "\",\"message\":\"";
+            vhlogAppendJsonEscaped(out, record.message);
+            out += '"';
+            vhlogAppendJsonFields(out, record.fields);
+            out += "}\n";
+        }
+        else {
+            out += "time=";
+            appendTimestamp(out, record.timestamp, layout);
+            out += " level=";
+            out += vhlogLevelName(record.level);
+            out += " msg=";
+            vhlogAppendLogfmtValue(out, record.message);
+            vhlogAppendLogfmtFields(out, record.fields);
+            out += '\n';
+        }
     }
-    
-    std::unique_lock<std::mutex> lock(socketMutex_, std::try_to_lock);
-    if (!lock.owns_lock() || tcpIsSending_) {
-        return;
+    target.offsets.push_back(out.size());
+
+    std::string_view text(out);
+    for (std::size_t i = 0; i < batchRecords_.size(); ++i) {
+        VHLogRecord record = batchRecords_[i];
+        record.line = text.substr(target.offsets[i], target.offsets[i + 1] - target.offsets[i]);
+        target.records.push_back(record);
     }
-    
-    if (tcpMessageQueue_.empty() || !socketConnected_) {
-        tcpIsSending_ = false;
-        
-        if (!tcpMessageQueue_.empty() && !socketConnected_ && !shutdownSocket_.load(std::memory_order_acquire)) {
-            asio::post(ioContext_, [this]() {
-                if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                    connectTCPSink();
-                }
-            });
-        }
+}
+
+void VHLogger::writeToDestination(VHLogLevel level, const std::string& message) {
+
+    std::vector<VHLogMessage> single(1);
+    single.front().level = level;
+    single.front().message = message;
+    single.front().timestamp = VHLogClock::ticks();
+    single.front().thread = threadNumber();
+    writeToDestination(single);
+}
+
+void VHLogger::appendRecord(const VHLogMessage& entry, bool composeLine, bool formatMessage) {
+
+    if (!entry.formatter && entry.message.empty()) {
         return;
     }
-    
-    tcpIsSending_ = true;
-    std::string message = std::move(tcpMessageQueue_.front());
-    tcpMessageQueue_.pop_front();
-    
-    if (shutdownSocket_.load(std::memory_order_acquire)) {
-        tcpIsSending_ = false;
+
+    std::string& batchText = *batchText_;
+    RecordOffsets offsets;
+    offsets.lineStart = batchText.size();
+    if (!formatMessage && entry.formatter && entry.argTypes) {
+        // Only raw sinks are listening and they can store the arguments as they are.
+        offsets.messageStart = offsets.messageEnd = offsets.lineEnd = offsets.lineStart;
+        batchOffsets_.push_back(offsets);
         return;
     }
-    
-    auto message_ptr = std::make_shared<std::string>(std::move(message));
-    
-    asio::async_write(socket_, asio::buffer(*message_ptr),
-        [this, message_ptr](std::error_code ec, size_t bytes_written) {
-            if (shutdownSocket_.load(std::memory_order_acquire)) {
-                std::lock_guard<std::mutex> lock(socketMutex_);
-                tcpIsSending_ = false;
-                return;
-            }
-            
-            {
-                std::lock_guard<std::mutex> lock(socketMutex_);
-                tcpIsSending_ = false;
-            }
-            
-            if (ec) {
-                if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                    std::lock_guard<std::mutex> lock(socketMutex_);
-                    if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                        tcpMessageQueue_.push_front(std::move(*message_ptr));
-                        
-                        std::error_code ignored_ec;
-                        socket_.close(ignored_ec);
-                        socketConnected_ = false;
-                        
-                        if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                            scheduleReconnectTCPSink();
-                        }
-                    }
-                }
-            } 
-            else {
-                if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                    bool connected = false;
-                    bool hasMore = false;
-                    {
-                        std::lock_guard<std::mutex> lock(socketMutex_);
-                        connected = socketConnected_;
-                        hasMore = !tcpMessageQueue_.empty();
-                    }
-                    
-                    if (hasMore && connected) {
-                        asio::post(ioContext_, [this]() {
-                            if (!shutdownSocket_.load(std::memory_order_acquire)) {
-                                sendNextTCPMessage();
-                            }
-                        });
-                    }
-                }
-            }
+    if (composeLine) {
+        appendTimestamp(batchText, clock_.toSystemTime(entry.timestamp));
+        batchText += " [";
+        batchText += vhlogLevelName(entry.level);
+        batchText += "] ";
+    }
+    offsets.messageStart = batchText.size();
+    if (entry.formatter) {
+        entry.formatter(batchText, entry.format, entry.message.data());
+    }
+    else {
+        batchText += entry.message.view().substr(0, entry.message.size() - entry.fieldsSize);
+    }
+    offsets.messageEnd = batchText.size();
+    if (composeLine) {
+        if (entry.fieldsSize > 0) {
+            std::string_view fields = entry.message.view().substr(entry.message.size() - entry.fieldsSize);
+            vhlogAppendLogfmtFields(batchText, fields);
         }
-    );
+        batchText += '\n';
+        offsets.lineEnd = batchText.size();
+    }
+    else {
+        offsets.lineEnd = offsets.lineStart;
+    }
+    batchOffsets_.push_back(offsets);
 }
 
-void VHLogger::startReadingForDisconnects() {
-    if (shutdownSocket_) {
-        return;
-    }
-        
-    socket_.async_read_some(
-        asio::buffer(readBuffer_), [this](std::error_code ec, std::size_t bytes_read) {
-            if (ec) {
-                if (ec != asio::error::operation_aborted) {
-                    {
-                        std::lock_guard<std::mutex> lock(socketMutex_);
-                        socketConnected_ = false;
-                        tcpIsSending_ = false;
-                    }
-                        
-                    if (!shutdownSocket_) {
-                        scheduleReconnectTCPSink();
-                    }
-                }
-            }
-            else {
-                startReadingForDisconnects();
-            }
-        }
-    );
+const VHLogTimeFields& VHLogger::localTimeFields(std::chrono::system_clock::time_point time) {
+
+    auto timeNs = std::chrono::time_point_cast<std::chrono::nanoseconds>(time);
+    auto timeSec = std::chrono::floor<std::chrono::seconds>(timeNs);
+    if (timeSec != timeFieldsSecond_ || timeFields_.year == 0) {
+        auto local = std::chrono::zoned_time(timeZone_, timeSec).get_local_time();
+        auto days = std::chrono::floor<std::chrono::days>(local);
+        std::chrono::year_month_day date(days);
+        std::chrono::hh_mm_ss clock(local - days);
+        timeFields_.year = static_cast<int>(date.year());
+        timeFields_.month = static_cast<unsigned>(date.month());
+        timeFields_.day = static_cast<unsigned>(date.day());
+        timeFields_.hour = static_cast<unsigned>(clock.hours().count());
+        timeFields_.minute = static_cast<unsigned>(clock.minutes().count());
+        timeFields_.second = static_cast<unsigned>(clock.seconds().count());
+        timeFieldsSecond_ = timeSec;
+    }
+    timeFields_.nanosecond = static_cast<std::uint32_t>((timeNs - timeSec).count());
+    return timeFields_;
 }
 
-void VHLogger::scheduleReconnectTCPSink() {
-    if (!reconnectTimer_ || shutdownSocket_) {
-        return;
+void VHLogger::flushSinks() {
+
+    for (const auto& sink : workerSinks_) {
+        sink->flush();
     }
-    
-    reconnectTimer_->expires_after(std::chrono::seconds(2));
-    reconnectTimer_->async_wait(
-        [this](std::error_code ec) { 
-            if (ec) {
-                return;
-            }
-            
-            if (shutdownSocket_) { 
-                return;
-            }
-            
-            connectTCPSink(); 
-        }
-    );
 }
 
-#endif
+void VHLogger::setTimestampPrecision(VHLogTimestampPrecision precision) {
+
+    timestampPrecision_.store(precision, std::memory_order_relaxed);
+}
+
+void VHLogger::appendTimestamp(std::string& out, std::chrono::system_clock::time_point now, VHLogLayout layout) {
+
+    auto nowNs = std::chrono::time_point_cast<std::chrono::nanoseconds>(now);
+    auto nowSec = std::chrono::floor<std::chrono::seconds>(nowNs);
+    TimestampCache& cache = layout == VHLogLayout::Text ? textTimestamp_ : isoTimestamp_;
+    if (nowSec != cache.second || cache.prefix.empty()) {
+        auto zt = std::chrono::zoned_time(timeZone_, nowSec);
+        // Rebuilt in place, the strings keep the capacity reserved by the constructor.
+        cache.prefix.clear();
+        cache.suffix.clear();
+        if (layout != VHLogLayout::Text) {
+            std::format_to(std::back_inserter(cache.prefix), "{:%Y-%m-%dT%H:%M:%S}", zt);
+            std::format_to(std::back_inserter(cache.suffix), "{:%Ez}", zt);
+        }
+        else {
+            std::format_to(std::back_inserter(cache.prefix), "[{:%Y-%m-%d_%H-%M:%S}", zt);
+            cache.suffix += ']';
+        }
+        cache.second = nowSec;
+    }
+    out += cache.prefix;
 
+    int digits = 0;
+    std::uint64_t divisor = 1;
+    switch (timestampPrecision_.load(std::memory_order_relaxed)) {
+        case VHLogTimestampPrecision::Seconds:
+            break;
+        case VHLogTimestampPrecision::Milliseconds:
+            digits = 3;
+            divisor = 1000000;
+            break;
+        case VHLogTimestampPrecision::Microseconds:
+            digits = 6;
+            divisor = 1000;
+            break;
+        case VHLogTimestampPrecision::Nanoseconds:
+            digits = 9;
+            break;
+    }
+    if (digits > 0) {
+        std::uint64_t fraction = static_cast<std::uint64_t>((nowNs - nowSec).count()) / divisor;
+        char buffer[10];
+        buffer[0] = '.';
+        for (int i = digits; i > 0; --i) {
+            buffer[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        out.append(buffer, digits + 1);
+    }
+    out += cache.suffix;
+}
@@ -0,0 +1,279 @@
+#include "VHLogArchiver.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <print>
+#include <string_view>
+#include <system_error>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t COMPRESS_CHUNK_SIZE = 64 * 1024;
+
+void lowerThreadPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+    // Nice values apply per thread on Linux.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 10);
+#endif
+}
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+// True when name is {stem}_YYYY-MM-DD_HH-MM:SS[_NNN]{extension}, as VHFileSink names
+// its files, or that name with .gz appended. Other sinks' files sharing the directory
+// and a prefix of the name, e.g. app_audit_... next to app_..., do not match.
+bool isSinkFileName(std::string_view name, std::string_view stem, std::string_view extension) {
+
+    static constexpr std::string_view TIMESTAMP_SHAPE = "0000-00-00_00-00:00";
+    if (!name.starts_with(stem) || name.size() < stem.size() + 1 + TIMESTAMP_SHAPE.size() ||
+        name[stem.size()] != '_') {
+        return false;
+    }
+    name.remove_prefix(stem.size() + 1);
+    for (std::size_t i = 0; i < TIMESTAMP_SHAPE.size(); ++i) {
+        bool digit = name[i] >= '0' && name[i] <= '9';
+        if (TIMESTAMP_SHAPE[i] == '0' ? !digit : name[i] != TIMESTAMP_SHAPE[i]) {
+            return false;
+        }
+    }
+    name.remove_prefix(TIMESTAMP_SHAPE.size());
+    if (name.starts_with('_')) {
+        std::size_t digits = 1;
+        while (digits < name.size() && name[digits] >= '0' && name[digits] <= '9') {
+            ++digits;
+        }
+        if (digits < 4) {
+            return false;
+        }
+        name.remove_prefix(digits);
+    }
+    if (name == extension) {
+        return true;
+    }
+    return name.ends_with(".gz") && name.substr(0, name.size() - 3) == extension;
+}
+
+}
+
+VHLogArchiver::VHLogArchiver(const std::string& basePathAndName, const std::string& extension,
+                             const VHLogArchivePolicy& policy, const std::string& activeFile) :
+    basePathAndName_(basePathAndName),
+    extension_(extension),
+    policy_(policy),
+    activeFile_(activeFile),
+    running_(true) {
+
+    // VHGzipFileSink segments are compressed already, gzipping them again gains nothing.
+    if (endsWith(extension_, ".gz")) {
+        policy_.compress = false;
+    }
+#ifndef USE_ZLIB
+    if (policy_.compress) {
+        std::println("Log compression needs a USE_ZLIB build, {} files stay uncompressed", basePathAndName_);
+        policy_.compress = false;
+    }
+#endif
+    thread_ = std::thread(&VHLogArchiver::run, this);
+}
+
+VHLogArchiver::~VHLogArchiver() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condVar_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void VHLogArchiver::setActiveFile(const std::string& fileName) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    activeFile_ = fileName;
+}
+
+void VHLogArchiver::fileClosed(const std::string& fileName) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closedFiles_.push_back(fileName);
+    }
+    condVar_.notify_one();
+}
+
+bool VHLogArchiver::isActive(const std::string& fileName) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fileName == activeFile_;
+}
+
+void VHLogArchiver::run() {
+
+    lowerThreadPriority();
+
+    // Segments a previous run closed but never got to.
+    if (policy_.compress) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& fileName : sinkFiles()) {
+            if (endsWith(fileName, extension_) && fileName != activeFile_) {
+                closedFiles_.push_back(std::move(fileName));
+            }
+        }
+    }
+    enforceRetention();
+
+    for (;;) {
+        std::string fileName;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condVar_.wait(lock, [this]() { return !closedFiles_.empty() || !running_; });
+            if (!running_) {
+                return;
+            }
+            fileName = std::move(closedFiles_.front());
+            closedFiles_.pop_front();
+        }
+        // Never touch the file the sink is writing to.
+        if (policy_.compress && !isActive(fileName)) {
+            compressFile(fileName);
+        }
+        enforceRetention();
+    }
+}
+
+bool VHLogArchiver::compressFile(const std::string& fileName) {
+
+#ifdef USE_ZLIB
+    std::FILE* input = std::fopen(fileName.c_str(), "rb");
+    if (!input) {
+        return false;
+    }
+    std::string compressedName = fileName + ".gz";
+    std::string partialName = compressedName + ".tmp";
+    std::FILE* output = std::fopen(partialName.c_str(), "wb");
+    if (!output) {
+        std::fclose(input);
+        return false;
+    }
+
+    z_stream stream{};
+    // windowBits 15 + 16 asks for a gzip wrapper.
+    bool ok = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    std::vector<unsigned char> in(COMPRESS_CHUNK_SIZE);
+    std::vector<unsigned char> out(COMPRESS_CHUNK_SIZE);
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH) {
+        std::size_t read = std::fread(in.data(), 1, in.size(), input);
+        if (std::ferror(input)) {
+            ok = false;
+            break;
+        }
+        flush = std::feof(input) ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = in.data();
+        stream.avail_in = static_cast<uInt>(read);
+        do {
+            stream.next_out = out.data();
+            stream.avail_out = static_cast<uInt>(out.size());
+            deflate(&stream, flush);
+            std::size_t produced = out.size() - stream.avail_out;
+            if (std::fwrite(out.data(), 1, produced, output) != produced) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0);
+    }
+    deflateEnd(&stream);
+    std::fclose(input);
+    if (std::fclose(output) != 0) {
+        ok = false;
+    }
+
+    std::error_code error;
+    if (!ok) {
+        std::println("Failed to compress log file: {}", fileName);
+        std::filesystem::remove(partialName, error);
+        return false;
+    }
+    std::filesystem::rename(partialName, compressedName, error);
+    if (error) {
+        std::filesystem::remove(partialName, error);
+        return false;
+    }
+    std::filesystem::remove(fileName, error);
+    return true;
+#else
+    (void)fileName;
+    return false;
+#endif
+}
+
+void VHLogArchiver::enforceRetention() {
+
+    if (policy_.maxFiles == 0 && policy_.maxTotalSize == 0) {
+        return;
+    }
+    std::vector<std::string> files = sinkFiles();
+    std::vector<std::uint64_t> sizes;
+    std::uint64_t totalSize = 0;
+    for (const auto& fileName : files) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(fileName, error);
+        sizes.push_back(error ? 0 : size);
+        totalSize += sizes.back();
+    }
+
+    // Names sort by their timestamp, so the oldest files come first.
+    std::size_t fileCount = files.size();
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        bool tooMany = policy_.maxFiles > 0 && fileCount > policy_.maxFiles;
+        bool tooLarge = policy_.maxTotalSize > 0 && totalSize > policy_.maxTotalSize;
+        if (!tooMany && !tooLarge) {
+            break;
+        }
+        if (isActive(files[i])) {
+            continue;
+        }
+        std::error_code error;
+        if (std::filesystem::remove(files[i], error)) {
+            --fileCount;
+            totalSize -= sizes[i];
+        }
+    }
+}
+
+std::vector<std::string> VHLogArchiver::sinkFiles() const {
+
+    std::filesystem::path base(basePathAndName_);
+    std::filesystem::path directory = base.parent_path();
+    std::string stem = base.filename().string();
+
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory.empty() ? "." : directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (isSinkFileName(name, stem, extension_)) {
+            files.push_back((directory / name).string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
@@ -0,0 +1,82 @@
+#include "VHLogBinaryFileSink.h"
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+std::int64_t nanosecondsSinceEpoch(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+char frameTag(VHLogBinaryFrame kind, VHLogLevel level) {
+    return static_cast<char>((static_cast<int>(kind) << 4) | static_cast<int>(level));
+}
+
+}
+
+VHBinaryFileSink::VHBinaryFileSink(const std::string& basePathAndName, std::size_t maxSize, std::size_t bufferSize) :
+    VHFileSink(basePathAndName, maxSize, bufferSize, false, ".vhlb"),
+    lastTimestamp_(0) {
+
+    if (fd_ >= 0) {
+        // The base constructor opened the file before this object's hooks existed.
+        fileOpened();
+    }
+}
+
+void VHBinaryFileSink::fileOpened() {
+
+    // Every file is self contained, ids start over and the header carries the time
+    // the first delta is relative to.
+    formatIds_.clear();
+    lastTimestamp_ = nanosecondsSinceEpoch(std::chrono::system_clock::now());
+
+    char header[VHLOG_BINARY_HEADER_SIZE];
+    std::memcpy(header, VHLOG_BINARY_MAGIC, sizeof(VHLOG_BINARY_MAGIC));
+    header[sizeof(VHLOG_BINARY_MAGIC)] = static_cast<char>(VHLOG_BINARY_VERSION);
+    header[sizeof(VHLOG_BINARY_MAGIC) + 1] = std::endian::native == std::endian::little ? 1 : 0;
+    std::memcpy(header + sizeof(VHLOG_BINARY_MAGIC) + 2, &lastTimestamp_, sizeof(lastTimestamp_));
+    append(std::string_view(header, sizeof(header)));
+}
+
+std::size_t VHBinaryFileSink::appendRecord(const VHLogRecord& record) {
+
+    frame_.clear();
+    std::int64_t timestamp = nanosecondsSinceEpoch(record.timestamp);
+    if (record.argTypes && !record.format.empty()) {
+        auto [found, inserted] = formatIds_.try_emplace(FormatKey(record.format.data(), record.argTypes),
+                                                        formatIds_.size());
+        if (inserted) {
+            std::string_view types(record.argTypes);
+            frame_ += frameTag(VHLogBinaryFrame::Format, VHLogLevel::DEBUGLV);
+            vhlogPutVarint(frame_, found->second);
+            vhlogPutVarint(frame_, record.format.size());
+            frame_ += record.format;
+            vhlogPutVarint(frame_, types.size());
+            frame_ += types;
+        }
+        frame_ += frameTag(VHLogBinaryFrame::Message, record.level);
+        vhlogPutSignedVarint(frame_, timestamp - lastTimestamp_);
+        vhlogPutVarint(frame_, found->second);
+        frame_ += record.args;
+    }
+    else if (!record.fields.empty()) {
+        // Stored as the text sinks show them, so the file format stays as it is.
+        fieldsText_.assign(record.message);
+        vhlogAppendLogfmtFields(fieldsText_, record.fields);
+        frame_ += frameTag(VHLogBinaryFrame::Text, record.level);
+        vhlogPutSignedVarint(frame_, timestamp - lastTimestamp_);
+        vhlogPutVarint(frame_, fieldsText_.size());
+        frame_ += fieldsText_;
+    }
+    else {
+        frame_ += frameTag(VHLogBinaryFrame::Text, record.level);
+        vhlogPutSignedVarint(frame_, timestamp - lastTimestamp_);
+        vhlogPutVarint(frame_, record.message.size());
+        frame_ += record.message;
+    }
+    lastTimestamp_ = timestamp;
+    append(frame_);
+    return frame_.size();
+}
@@ -0,0 +1,156 @@
+#include "VHLogFields.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr std::uint64_t ONES = 0x0101010101010101ull;
+constexpr std::uint64_t HIGHS = 0x8080808080808080ull;
+
+// Nonzero when some byte of word is zero. Only the lowest flagged byte is exact,
+// which is all the callers need.
+constexpr std::uint64_t zeroBytes(std::uint64_t word) {
+    return (word - ONES) & ~word & HIGHS;
+}
+
+// Length of the prefix of text that can go into a JSON string as is: no control
+// characters, quotes or backslashes. Checks eight bytes per step, most messages are
+// skipped without looking at single characters.
+std::size_t jsonSafePrefix(std::string_view text) {
+
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= text.size(); i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        std::uint64_t control = (word - 0x20 * ONES) & ~word & HIGHS;
+        if (control | zeroBytes(word ^ ('"' * ONES)) | zeroBytes(word ^ ('\\' * ONES))) {
+            break;
+        }
+    }
+    for (; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x20 || c == '"' || c == '\\') {
+            break;
+        }
+    }
+    return i;
+}
+
+template <typename T>
+void appendNumber(std::string& out, T value) {
+
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void appendValue(std::string& out, const VHLogField& field, bool json) {
+
+    switch (field.type) {
+        case VHLogFieldType::Int:
+            appendNumber(out, field.intValue);
+            break;
+        case VHLogFieldType::UInt:
+            appendNumber(out, field.uintValue);
+            break;
+        case VHLogFieldType::Double:
+            // JSON has no literal for infinities and NaN.
+            if (json && !std::isfinite(field.doubleValue)) {
+                out += "null";
+            }
+            else {
+                appendNumber(out, field.doubleValue);
+            }
+            break;
+        case VHLogFieldType::Bool:
+            out += field.boolValue ? "true" : "false";
+            break;
+        case VHLogFieldType::String:
+            if (json) {
+                out += '"';
+                vhlogAppendJsonEscaped(out, field.text);
+                out += '"';
+            }
+            else {
+                vhlogAppendLogfmtValue(out, field.text);
+            }
+            break;
+    }
+}
+
+}
+
+void vhlogAppendJsonEscaped(std::string& out, std::string_view text) {
+
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    while (!text.empty()) {
+        std::size_t safe = jsonSafePrefix(text);
+        out.append(text.data(), safe);
+        if (safe == text.size()) {
+            return;
+        }
+        unsigned char c = static_cast<unsigned char>(text[safe]);
+        text.remove_prefix(safe + 1);
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                out += "\\u00";
+                out += HEX_DIGITS[c >> 4];
+                out += HEX_DIGITS[c & 0xf];
+        }
+    }
+}
+
+void vhlogAppendJsonFields(std::string& out, std::string_view fields) {
+
+    vhlogForEachField(fields, [&out](const VHLogField& field) {
+        out += ",\"";
+        vhlogAppendJsonEscaped(out, field.key);
+        out += "\":";
+        appendValue(out, field, true);
+    });
+}
+
+void vhlogAppendLogfmtValue(std::string& out, std::string_view text) {
+
+    bool quote = text.empty();
+    for (std::size_t i = 0; i < text.size() && !quote; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        quote = c <= ' ' || c == '=' || c == '"' || c == '\\';
+    }
+    if (!quote) {
+        out += text;
+        return;
+    }
+    out += '"';
+    vhlogAppendJsonEscaped(out, text);
+    out += '"';
+}
+
+void vhlogAppendLogfmtFields(std::string& out, std::string_view fields) {
+
+    vhlogForEachField(fields, [&out](const VHLogField& field) {
+        out += ' ';
+        out += field.key;
+        out += '=';
+        appendValue(out, field, false);
+    });
+}
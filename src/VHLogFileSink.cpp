@@ -0,0 +1,495 @@
+#include "VHLogFileSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <format>
+#include <print>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// How often a helper waiting for a sync deadline checks for rotation work.
+constexpr auto SYNC_POLL_INTERVAL = std::chrono::milliseconds(5);
+
+int openForAppend(const std::string& fileName, bool readWrite) {
+#ifdef _WIN32
+    return _open(fileName.c_str(), (readWrite ? _O_RDWR : _O_WRONLY) | _O_CREAT | _O_APPEND | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+#else
+    return ::open(fileName.c_str(), (readWrite ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+void closeDescriptor(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+void syncDescriptor(int fd) {
+#ifdef _WIN32
+    _commit(fd);
+#elif defined(__APPLE__)
+    ::fsync(fd);
+#else
+    ::fdatasync(fd);
+#endif
+}
+
+// Writes first and then second, retrying on short writes and EINTR. On POSIX both go
+// out in one writev() call in the common case.
+bool writeAll(int fd, std::string_view first, std::string_view second) {
+#ifdef _WIN32
+    for (std::string_view part : {first, second}) {
+        while (!part.empty()) {
+            int written = _write(fd, part.data(), static_cast<unsigned int>(part.size()));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            part.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+    return true;
+#else
+    while (!first.empty() || !second.empty()) {
+        iovec parts[2];
+        int count = 0;
+        if (!first.empty()) {
+            parts[count++] = iovec{const_cast<char*>(first.data()), first.size()};
+        }
+        if (!second.empty()) {
+            parts[count++] = iovec{const_cast<char*>(second.data()), second.size()};
+        }
+        ssize_t written = ::writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        auto consumed = static_cast<std::size_t>(written);
+        std::size_t fromFirst = std::min(consumed, first.size());
+        first.remove_prefix(fromFirst);
+        second.remove_prefix(consumed - fromFirst);
+    }
+    return true;
+#endif
+}
+
+}
+
+VHFileSink::VHFileSink(const std::string& basePathAndName, std::size_t maxSize, std::size_t bufferSize) :
+    VHFileSink(basePathAndName, maxSize, bufferSize, false) {
+}
+
+VHFileSink::VHFileSink(const std::string& basePathAndName, std::size_t maxSize, std::size_t bufferSize,
+                       bool readWrite, std::string_view extension) :
+    fd_(-1),
+    bufferSize_(std::clamp(bufferSize, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE)),
+    basePathAndName_(basePathAndName),
+    maxSize_(maxSize),
+    currentSize_(0),
+    readWrite_(readWrite),
+    extension_(extension),
+    timeZone_(std::chrono::current_zone()),
+    rotation_(VHLogRotation::Daily),
+    rotationInterval_(60),
+    rotationRequested_(false),
+    nextFilePublished_(false),
+    nextFileName_(std::format("{}_next{}.tmp", basePathAndName, extension)) {
+
+    buffer_.reserve(bufferSize_);
+    openFile();
+    helperThread_ = std::thread(&VHFileSink::helperWorker, this);
+}
+
+VHFileSink::~VHFileSink() {
+
+    writeBuffer();
+    // The helper may still sync fd_, stop it before closing.
+    helperRunning_.store(false, std::memory_order_release);
+    signalHelper();
+    if (helperThread_.joinable()) {
+        helperThread_.join();
+    }
+    closeFile();
+}
+
+void VHFileSink::openFile() {
+
+    auto nowSec = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    std::string fileName = fileNameFor(nowSec);
+    scheduleRotation(nowSec);
+
+    fd_ = openForAppend(fileName, readWrite_);
+    if (fd_ < 0) {
+        std::println("Failed to open/create log file: {}", fileName);
+        return;
+    }
+    currentFileName_ = std::move(fileName);
+    fileOpened();
+}
+
+std::string VHFileSink::fileNameFor(std::chrono::sys_seconds time, int sequence) const {
+
+    auto zt = std::chrono::zoned_time(timeZone_, time);
+    if (sequence > 0) {
+        return std::format("{}_{:%Y-%m-%d_%H-%M:%S}_{:03}{}", basePathAndName_, zt, sequence, extension_);
+    }
+    return std::format("{}_{:%Y-%m-%d_%H-%M:%S}{}", basePathAndName_, zt, extension_);
+}
+
+void VHFileSink::closeFile() {
+
+    if (fd_ >= 0) {
+        fileClosing();
+        if (durability_.mode == VHLogDurability::SyncInterval || durability_.mode == VHLogDurability::SyncOnLevel) {
+            syncDescriptor(fd_);
+        }
+        closeDescriptor(fd_);
+        fd_ = -1;
+    }
+}
+
+bool VHFileSink::rotateFileSink() {
+   
+    int nextFd = readyFd_.exchange(-1, std::memory_order_acquire);
+    if (nextFd < 0) {
+        if (!rotationRequested_) {
+            rotationRequested_ = true;
+            fileWanted_.store(true, std::memory_order_relaxed);
+            signalHelper();
+        }
+        return false;
+    }
+
+    auto nowSec = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    writeBuffer();
+    fileClosing();
+    // At most one descriptor is ever on its way back, the queue cannot be full.
+    if (!retiredFiles_.tryPush(RetiredFile{fd_, nowSec})) {
+        closeDescriptor(fd_);
+    }
+    fd_ = nextFd;
+    currentSize_ = 0;
+    rotationRequested_ = false;
+    scheduleRotation(nowSec);
+    fileOpened();
+    signalHelper();
+    return true;
+}
+
+void VHFileSink::signalHelper() {
+
+    helperSignal_.fetch_add(1, std::memory_order_release);
+    helperSignal_.notify_one();
+}
+
+void VHFileSink::helperWorker() {
+
+    std::uint32_t seen = helperSignal_.load(std::memory_order_acquire);
+    for (;;) {
+        RetiredFile retired;
+        while (retiredFiles_.tryPop(retired)) {
+            retireFile(retired);
+        }
+        if (!helperRunning_.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (!nextFilePublished_) {
+            prepareNextFile();
+        }
+        if (syncFd_.load(std::memory_order_acquire) >= 0) {
+            runPendingSync(seen);
+        }
+        else {
+            helperSignal_.wait(seen, std::memory_order_acquire);
+        }
+        seen = helperSignal_.load(std::memory_order_acquire);
+    }
+
+    // A file retired between the last drain and the helperRunning_ check above would
+    // otherwise keep its descriptor open and its temporary name.
+    RetiredFile retired;
+    while (retiredFiles_.tryPop(retired)) {
+        retireFile(retired);
+    }
+    int syncFd = syncFd_.exchange(-1, std::memory_order_acquire);
+    if (syncFd >= 0) {
+        syncDescriptor(syncFd);
+    }
+    // Nobody will claim the prepared file any more.
+    int fd = readyFd_.exchange(-1, std::memory_order_acquire);
+    if (fd >= 0) {
+        closeDescriptor(fd);
+        std::remove(nextFileName_.c_str());
+    }
+}
+
+void VHFileSink::runPendingSync(std::uint32_t seen) {
+
+    auto due = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(syncDue_.load(std::memory_order_relaxed)));
+    for (auto now = std::chrono::steady_clock::now(); now < due; now = std::chrono::steady_clock::now()) {
+        if (helperSignal_.load(std::memory_order_acquire) != seen) {
+            return;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(due - now, SYNC_POLL_INTERVAL));
+    }
+    // Everything written to the descriptor until now goes out with this one sync.
+    int fd = syncFd_.exchange(-1, std::memory_order_acquire);
+    if (fd >= 0) {
+        syncDescriptor(fd);
+    }
+}
+
+// Hands the helper an fdatasync of fd_, at most one per syncInterval. The logger thread
+// writes the buffer out (prepareSync) right before a sync is due, so it covers every
+// line logged up to then. While idle with everything written, the sync is left to the helper at its
+// due time instead.
+void VHFileSink::requestSync() {
+
+    if (durability_.mode != VHLogDurability::SyncInterval || fd_ < 0 ||
+        syncFd_.load(std::memory_order_acquire) >= 0) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextSync_ && !buffer_.empty()) {
+        // A later batch or flush hands it over, after writing these lines out.
+        return;
+    }
+    syncDeferred_ = now < nextSync_;
+    prepareSync();
+    auto due = std::max(now, nextSync_);
+    nextSync_ = due + durability_.syncInterval;
+    syncDue_.store(due.time_since_epoch().count(), std::memory_order_relaxed);
+    syncFd_.store(fd_, std::memory_order_release);
+    signalHelper();
+}
+
+// New lines are coming while a deferred sync waits for its due time. Takes it back if
+// the helper has not started it, requestSync() then hands it over again with them.
+void VHFileSink::reclaimDeferredSync() {
+
+    if (!syncDeferred_) {
+        return;
+    }
+    syncDeferred_ = false;
+    int expected = fd_;
+    if (syncFd_.compare_exchange_strong(expected, -1, std::memory_order_acq_rel)) {
+        nextSync_ -= durability_.syncInterval;
+    }
+}
+
+void VHFileSink::prepareNextFile() {
+
+#ifdef _WIN32
+    // Open files cannot be renamed here, so the next file is only opened once the
+    // logger thread asks for it, under its final name.
+    if (!fileWanted_.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+    nextFileName_ = fileNameFor(std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()));
+#endif
+    int fd = openForAppend(nextFileName_, readWrite_);
+    if (fd < 0) {
+        std::println("Failed to open/create log file: {}", nextFileName_);
+        return;
+    }
+    nextFilePublished_ = true;
+    readyFd_.store(fd, std::memory_order_release);
+}
+
+void VHFileSink::retireFile(const RetiredFile& retired) {
+
+    std::string closedFile = std::move(currentFileName_);
+#ifdef _WIN32
+    currentFileName_ = nextFileName_;
+#else
+    // The prepared file is in use already; give it the name of the moment it took
+    // over. Further rotations within that second get numbered names that sort after it.
+    for (int sequence = 0; ; ++sequence) {
+        currentFileName_ = fileNameFor(retired.rotatedAt, sequence);
+        if (::access(currentFileName_.c_str(), F_OK) == 0) {
+            continue;
+        }
+        if (::link(nextFileName_.c_str(), currentFileName_.c_str()) == 0) {
+            ::unlink(nextFileName_.c_str());
+            break;
+        }
+        // File systems without hard links.
+        if (errno != EEXIST) {
+            if (::rename(nextFileName_.c_str(), currentFileName_.c_str()) != 0) {
+                std::println("Failed to rename log file: {}", nextFileName_);
+            }
+            break;
+        }
+    }
+#endif
+    if (archiver_) {
+        archiver_->setActiveFile(currentFileName_);
+    }
+
+    // This sync covers a pending interval sync of the same descriptor.
+    int expected = retired.fd;
+    syncFd_.compare_exchange_strong(expected, -1, std::memory_order_relaxed);
+    syncDescriptor(retired.fd);
+    closeDescriptor(retired.fd);
+    if (archiver_ && !closedFile.empty()) {
+        archiver_->fileClosed(closedFile);
+    }
+    nextFilePublished_ = false;
+}
+
+void VHFileSink::setRotationPolicy(VHLogRotation rotation, std::chrono::minutes interval) {
+
+    rotation_ = rotation;
+    rotationInterval_ = std::max(interval, std::chrono::minutes(1));
+    scheduleRotation(std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()));
+}
+
+void VHFileSink::scheduleRotation(std::chrono::sys_seconds now) {
+
+    using namespace std::chrono;
+
+    if (rotation_ == VHLogRotation::Size) {
+        nextRotation_ = system_clock::time_point::max();
+        return;
+    }
+    // Boundaries are local time; to_sys picks the earlier instant around DST changes.
+    auto local = zoned_time(timeZone_, now).get_local_time();
+    auto midnight = floor<days>(local);
+    local_seconds next;
+    switch (rotation_) {
+        case VHLogRotation::Hourly:
+            next = floor<hours>(local) + hours(1);
+            break;
+        case VHLogRotation::Minutes:
+            next = midnight + (floor<minutes>(local - midnight) / rotationInterval_ + 1) * rotationInterval_;
+            break;
+        default:
+            next = midnight + days(1);
+            break;
+    }
+    nextRotation_ = timeZone_->to_sys(next, choose::earliest);
+}
+
+void VHFileSink::setDurabilityPolicy(const VHLogDurabilityPolicy& policy) {
+
+    durability_ = policy;
+}
+
+void VHFileSink::setArchivePolicy(const VHLogArchivePolicy& policy) {
+
+    archiver_.reset();
+    archiver_ = std::make_unique<VHLogArchiver>(basePathAndName_, extension_, policy, currentFileName_);
+}
+
+std::size_t VHFileSink::appendRecord(const VHLogRecord& record) {
+
+    append(record.line);
+    return record.line.size();
+}
+
+void VHFileSink::append(std::string_view line) {
+
+    if (buffer_.size() + line.size() > bufferSize_) {
+        // Hand the buffered bytes and the line that did not fit to one vectored write.
+        writeBuffer(line);
+        return;
+    }
+    buffer_.append(line);
+}
+
+void VHFileSink::writeBuffer(std::string_view extra) {
+
+    if (fd_ >= 0 && (!buffer_.empty() || !extra.empty())) {
+        if (!writeAll(fd_, buffer_, extra)) {
+            std::println("Failed to write to log file: {}", basePathAndName_);
+        }
+    }
+    buffer_.clear();
+}
+
+void VHFileSink::syncFile() {
+
+    if (fd_ >= 0) {
+        syncDescriptor(fd_);
+    }
+}
+
+void VHFileSink::write(std::span<const VHLogRecord> records) {
+
+    if (fd_ < 0) {
+        return;
+    }
+    bool bShouldFlush = false;
+    bool bShouldSync = false;
+    bool bAccepted = false;
+    for (const auto& record : records) {
+        if (!accepts(record.level)) {
+            continue;
+        }
+        if (!bAccepted) {
+            reclaimDeferredSync();
+            bAccepted = true;
+        }
+        std::size_t recordSize = appendRecord(record);
+        currentSize_ += recordSize;
+        if (durability_.mode == VHLogDurability::SyncOnLevel && record.level >= durability_.syncLevel) {
+            bShouldSync = true;
+        }
+        if (record.level == VHLogLevel::FATALLV || record.level == VHLogLevel::ERRORLV) {
+            bShouldFlush = durability_.mode != VHLogDurability::None;
+        }
+        else if (currentSize_ + recordSize > maxSize_ || record.timestamp >= nextRotation_) {
+            if (bShouldSync) {
+                // The helper syncs the file it gets back only later.
+                writeBuffer();
+                syncFile();
+                bShouldSync = false;
+            }
+            if (rotateFileSink()) {
+                bShouldFlush = false;
+            }
+        }
+    }
+    if (bShouldSync) {
+        // One sync for every line of the batch.
+        writeBuffer();
+        syncFile();
+    }
+    else if (bShouldFlush) {
+        writeBuffer();
+    }
+    if (bAccepted) {
+        requestSync();
+    }
+}
+
+void VHFileSink::flush() {
+
+    if (durability_.mode != VHLogDurability::None) {
+        writeBuffer();
+        requestSync();
+    }
+    if (rotationRequested_) {
+        // The helper could not open the next file before, have it try again.
+        signalHelper();
+    }
+}
@@ -0,0 +1,227 @@
+#include "VHLogGzipFileSink.h"
+#include <algorithm>
+#include <print>
+#include <utility>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+
+namespace {
+
+constexpr std::size_t DEFLATE_CHUNK_SIZE = 64 * 1024;
+
+}
+
+struct VHGzipFileSink::Stream {
+    z_stream zs{};
+
+    ~Stream() {
+        deflateEnd(&zs);
+    }
+};
+
+VHGzipFileSink::VHGzipFileSink(const std::string& basePathAndName, std::size_t maxSize,
+                               std::chrono::milliseconds frameInterval, int compressionLevel,
+                               std::size_t bufferSize) :
+    VHFileSink(basePathAndName, maxSize, bufferSize, false, ".log.gz"),
+    frameInterval_(frameInterval),
+    frameStart_(std::chrono::steady_clock::now()),
+    frameInput_(0),
+    closeFrame_(false),
+    syncFrame_(false) {
+
+    auto stream = std::make_unique<Stream>();
+    // windowBits 15 + 16 asks for a gzip wrapper, each deflateReset starts a new member.
+    if (deflateInit2(&stream->zs, std::clamp(compressionLevel, 1, 9), Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        std::println("Failed to initialise compression for log file: {}", basePathAndName_);
+        return;
+    }
+    stream_ = std::move(stream);
+    compressed_.reserve(bufferSize_);
+}
+
+VHGzipFileSink::~VHGzipFileSink() {
+
+    // The base destructor no longer sees these overrides.
+    writeBuffer();
+    finishFrame();
+}
+
+void VHGzipFileSink::write(std::span<const VHLogRecord> records) {
+
+    for (const auto& record : records) {
+        if (accepts(record.level) &&
+            (record.level == VHLogLevel::ERRORLV || record.level == VHLogLevel::FATALLV)) {
+            // The base sink flushes after this batch, that flush closes the frame.
+            closeFrame_ = true;
+            break;
+        }
+    }
+    VHFileSink::write(records);
+    closeFrame_ = false;
+}
+
+void VHGzipFileSink::flush() {
+
+    syncFrame_ = true;
+    VHFileSink::flush();
+    syncFrame_ = false;
+}
+
+void VHGzipFileSink::fileOpened() {
+
+    frameStart_ = std::chrono::steady_clock::now();
+}
+
+void VHGzipFileSink::fileClosing() {
+
+    finishFrame();
+}
+
+void VHGzipFileSink::syncFile() {
+
+    if (stream_ && frameInput_ > 0) {
+        // Make the open frame decodable up to here before it goes to disk.
+        compress({}, Z_SYNC_FLUSH);
+        writeCompressed();
+    }
+    VHFileSink::syncFile();
+}
+
+void VHGzipFileSink::prepareSync() {
+
+    writeBuffer();
+    if (stream_ && fd_ >= 0 && frameInput_ > 0) {
+        // The helper's sync only covers what zlib has emitted, so SyncInterval pays for
+        // a sync flush with every sync it requests.
+        compress({}, Z_SYNC_FLUSH);
+        writeCompressed();
+    }
+}
+
+void VHGzipFileSink::writeBuffer(std::string_view extra) {
+
+    if (!stream_ || fd_ < 0) {
+        VHFileSink::writeBuffer(extra);
+        return;
+    }
+    if (frameInput_ == 0 && (!buffer_.empty() || !extra.empty())) {
+        frameStart_ = std::chrono::steady_clock::now();
+    }
+    compress(buffer_, Z_NO_FLUSH);
+    compress(extra, Z_NO_FLUSH);
+    buffer_.clear();
+
+    auto now = std::chrono::steady_clock::now();
+    if (frameInput_ > 0 && (closeFrame_ || frameInput_ >= MAX_FRAME_INPUT || now - frameStart_ >= frameInterval_)) {
+        finishFrame();
+        return;
+    }
+    if (frameInput_ > 0 && syncFrame_ && now - lastSyncFlush_ >= frameInterval_) {
+        // Going idle: push everything written so far to the file without ending the
+        // member, it stays decodable up to here. Each sync flush empties the compression
+        // window, so a logger that often runs out of work only does it once per interval.
+        compress({}, Z_SYNC_FLUSH);
+        lastSyncFlush_ = now;
+    }
+    writeCompressed();
+}
+
+void VHGzipFileSink::compress(std::string_view input, int mode) {
+
+    if (input.empty() && mode == Z_NO_FLUSH) {
+        return;
+    }
+    z_stream& zs = stream_->zs;
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    zs.avail_in = static_cast<uInt>(input.size());
+    frameInput_ += input.size();
+    int result = Z_OK;
+    do {
+        std::size_t used = compressed_.size();
+        compressed_.resize(used + DEFLATE_CHUNK_SIZE);
+        zs.next_out = reinterpret_cast<Bytef*>(compressed_.data() + used);
+        zs.avail_out = static_cast<uInt>(DEFLATE_CHUNK_SIZE);
+        result = deflate(&zs, mode);
+        compressed_.resize(used + DEFLATE_CHUNK_SIZE - zs.avail_out);
+    } while (zs.avail_out == 0 || (mode == Z_FINISH && result == Z_OK));
+}
+
+void VHGzipFileSink::finishFrame() {
+
+    if (!stream_) {
+        return;
+    }
+    if (frameInput_ > 0) {
+        compress({}, Z_FINISH);
+        deflateReset(&stream_->zs);
+        frameInput_ = 0;
+    }
+    writeCompressed();
+}
+
+void VHGzipFileSink::writeCompressed() {
+
+    if (compressed_.empty()) {
+        return;
+    }
+    // Hand the compressed bytes to the base sink's descriptor write.
+    buffer_.swap(compressed_);
+    VHFileSink::writeBuffer();
+    buffer_.swap(compressed_);
+}
+
+#else
+
+struct VHGzipFileSink::Stream {};
+
+VHGzipFileSink::VHGzipFileSink(const std::string& basePathAndName, std::size_t maxSize,
+                               std::chrono::milliseconds frameInterval, int, std::size_t bufferSize) :
+    VHFileSink(basePathAndName, maxSize, bufferSize),
+    frameInterval_(frameInterval),
+    frameInput_(0),
+    closeFrame_(false),
+    syncFrame_(false) {
+
+    std::println("Log compression needs a USE_ZLIB build, {} is written uncompressed", basePathAndName_);
+}
+
+VHGzipFileSink::~VHGzipFileSink() {
+
+    VHFileSink::writeBuffer();
+}
+
+void VHGzipFileSink::write(std::span<const VHLogRecord> records) {
+
+    VHFileSink::write(records);
+}
+
+void VHGzipFileSink::flush() {
+
+    VHFileSink::flush();
+}
+
+void VHGzipFileSink::writeBuffer(std::string_view extra) {
+
+    VHFileSink::writeBuffer(extra);
+}
+
+void VHGzipFileSink::fileOpened() {}
+void VHGzipFileSink::fileClosing() {}
+
+void VHGzipFileSink::syncFile() {
+
+    VHFileSink::syncFile();
+}
+
+void VHGzipFileSink::prepareSync() {
+
+    VHFileSink::prepareSync();
+}
+
+void VHGzipFileSink::compress(std::string_view, int) {}
+void VHGzipFileSink::finishFrame() {}
+void VHGzipFileSink::writeCompressed() {}
+
+#endif
@@ -0,0 +1,147 @@
+#include "VHLogMappedFileSink.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+std::size_t pageSize() {
+
+    static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+#endif
+
+}
+
+VHMappedFileSink::VHMappedFileSink(const std::string& basePathAndName, std::size_t maxSize) :
+    VHFileSink(basePathAndName, maxSize, DEFAULT_BUFFER_SIZE, true),
+    mapping_(nullptr),
+    mappingLength_(0),
+    mappingOffset_(0),
+    position_(0),
+    syncedPosition_(0) {
+
+    if (fd_ >= 0) {
+        // The base constructor opened the file before this object's hooks existed.
+        fileOpened();
+    }
+}
+
+VHMappedFileSink::~VHMappedFileSink() {
+
+    unmapSegment();
+}
+
+void VHMappedFileSink::fileOpened() {
+
+#ifndef _WIN32
+    off_t end = ::lseek(fd_, 0, SEEK_END);
+    if (end >= 0) {
+        mapSegment(static_cast<std::uint64_t>(end), std::clamp(maxSize_, MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE));
+    }
+#endif
+}
+
+void VHMappedFileSink::fileClosing() {
+
+    unmapSegment();
+}
+
+void VHMappedFileSink::append(std::string_view line) {
+
+    if (mapping_ && position_ + line.size() > mappingLength_) {
+        // Ran past the preallocated size: map another segment right after the data.
+        std::uint64_t end = mappingOffset_ + position_;
+        unmapSegment();
+        mapSegment(end, std::max(std::clamp(maxSize_, MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE), line.size()));
+    }
+    if (!mapping_) {
+        VHFileSink::append(line);
+        return;
+    }
+    std::memcpy(mapping_ + position_, line.data(), line.size());
+    position_ += line.size();
+}
+
+void VHMappedFileSink::writeBuffer(std::string_view extra) {
+
+    if (!mapping_) {
+        VHFileSink::writeBuffer(extra);
+        return;
+    }
+#ifndef _WIN32
+    // The bytes are already in the page cache. Start writeback of what was added since
+    // the last flush and drop the finished pages from this process.
+    std::size_t syncStart = syncedPosition_ & ~(pageSize() - 1);
+    std::size_t pageStart = position_ & ~(pageSize() - 1);
+    if (position_ > syncStart) {
+        ::msync(mapping_ + syncStart, position_ - syncStart, MS_ASYNC);
+    }
+    if (pageStart > syncStart) {
+        ::madvise(mapping_ + syncStart, pageStart - syncStart, MADV_DONTNEED);
+    }
+    syncedPosition_ = position_;
+#endif
+}
+
+bool VHMappedFileSink::mapSegment(std::uint64_t offset, std::size_t size) {
+
+#ifdef _WIN32
+    (void)offset;
+    (void)size;
+    return false;
+#else
+    // mmap needs a page aligned offset, so an existing partial page is mapped as well.
+    std::uint64_t alignedOffset = offset & ~static_cast<std::uint64_t>(pageSize() - 1);
+    auto lead = static_cast<std::size_t>(offset - alignedOffset);
+    auto fileEnd = static_cast<off_t>(offset + size);
+
+    // Fall back to a sparse file only where the file system cannot preallocate. On any
+    // other error, a full disk above all, the pages could not be backed and the first
+    // store into them would raise SIGBUS; lines go through write() instead.
+    int result = ::posix_fallocate(fd_, static_cast<off_t>(offset), static_cast<off_t>(size));
+    if (result != 0) {
+        if ((result != EOPNOTSUPP && result != EINVAL) || ::ftruncate(fd_, fileEnd) != 0) {
+            // Drop whatever part of the segment did get allocated.
+            (void)::ftruncate(fd_, static_cast<off_t>(offset));
+            return false;
+        }
+    }
+    void* mapping = ::mmap(nullptr, lead + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                           static_cast<off_t>(alignedOffset));
+    if (mapping == MAP_FAILED) {
+        (void)::ftruncate(fd_, static_cast<off_t>(offset));
+        return false;
+    }
+    ::madvise(mapping, lead + size, MADV_SEQUENTIAL);
+
+    mapping_ = static_cast<char*>(mapping);
+    mappingLength_ = lead + size;
+    mappingOffset_ = alignedOffset;
+    position_ = lead;
+    syncedPosition_ = lead;
+    return true;
+#endif
+}
+
+void VHMappedFileSink::unmapSegment() {
+
+#ifndef _WIN32
+    if (!mapping_) {
+        return;
+    }
+    ::munmap(mapping_, mappingLength_);
+    // Drop the unused preallocated tail; with O_APPEND any fallback writes land here.
+    (void)::ftruncate(fd_, static_cast<off_t>(mappingOffset_ + position_));
+    mapping_ = nullptr;
+    mappingLength_ = 0;
+#endif
+}
@@ -0,0 +1,14 @@
+#include "VHLogSink.h"
+#include <cstdio>
+
+void VHConsoleSink::write(std::span<const VHLogRecord> records) {
+
+    forEachLineRun(records, [](std::string_view lines) {
+        std::fwrite(lines.data(), 1, lines.size(), stdout);
+    });
+}
+
+void VHConsoleSink::flush() {
+
+    std::fflush(stdout);
+}
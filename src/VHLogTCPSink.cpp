@@ -0,0 +1,543 @@
+#ifdef USE_ASIO
+#include "VHLogTCPSink.h"
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <print>
+#include <system_error>
+#include <utility>
+
+VHTCPSink::VHTCPSink(const std::string& hostIpAddress, unsigned int hostPort, std::size_t maxQueueBytes,
+                     const std::string& spoolPath) :
+    hostIpAddress_(hostIpAddress),
+    hostPort_(hostPort),
+    socket_(ioContext_),
+    maxQueueBytes_(maxQueueBytes),
+    queuedBytes_(0),
+    spoolPath_(spoolPath),
+    spoolReadOffset_(0),
+    spooling_(false),
+    droppedLines_(0),
+    reconnectAttempts_(0),
+    reconnectPending_(false),
+    random_(std::random_device{}()) {
+
+    if (!spoolPath_.empty()) {
+        // Lines an earlier run could not deliver go first.
+        std::error_code error;
+        spooling_ = std::filesystem::file_size(spoolPath_, error) > 0 && !error;
+    }
+    tcpIsSending_ = false;
+    socketConnected_ = false;
+    shutdownSocket_.store(false, std::memory_order_release);  
+    reconnectTimer_ = std::make_unique<asio::steady_timer>(ioContext_);
+
+    workGuard_ = std::make_unique<asio::executor_work_guard<asio::io_context::executor_type>>(
+        asio::make_work_guard(ioContext_)
+    );
+    ioThread_ = std::thread([this] { 
+        ioContext_.run(); 
+    });
+    // The connection state belongs to the I/O thread, so the first attempt runs there too.
+    asio::post(ioContext_, [this]() { connectTCPSink(); });
+}
+
+VHTCPSink::~VHTCPSink() {
+
+    shutdownSocket_.store(true, std::memory_order_release);
+    if (reconnectTimer_) {
+        reconnectTimer_->cancel();
+    }
+    
+    std::error_code ec;
+    socket_.cancel(ec);
+    
+    ioContext_.restart();
+    while (ioContext_.poll_one() > 0) {}
+    
+    {
+        std::lock_guard<std::mutex> lock(socketMutex_);
+        tcpIsSending_ = false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(socketMutex_);
+        if (socket_.is_open()) {
+            socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+            socket_.close(ec);
+        }
+        socketConnected_ = false;
+    }
+    
+    ioContext_.stop();
+    
+    if (workGuard_) {
+        workGuard_.reset();
+    }
+    
+    if (ioThread_.joinable()) { 
+        ioThread_.join();
+    }
+    
+    ioContext_.restart();
+    while (ioContext_.poll_one() > 0) {}
+    spoolUnsentMessages();
+}
+
+void VHTCPSink::write(std::span<const VHLogRecord> records) {
+
+    // Not called by the logger, which hands over its buffer through writeShared.
+    auto text = std::make_shared<std::string>();
+    forEachLineRun(records, [&](std::string_view run) { text->append(run); });
+    if (!text->empty()) {
+        std::string_view view(*text);
+        passToIOThread(TCPMessage{std::move(text), view});
+    }
+}
+
+void VHTCPSink::writeShared(std::span<const VHLogRecord> records,
+                            const std::shared_ptr<const std::string>& batchText) {
+
+    // The lines stay in the logger's buffer until they are sent, no copy per line or batch.
+    forEachLineRun(records, [&](std::string_view run) { passToIOThread(TCPMessage{batchText, run}); });
+}
+
+void VHTCPSink::passToIOThread(TCPMessage message) {
+
+    if (shutdownSocket_) {
+        return;
+    }
+    while (!pendingMessages_.tryPush(std::move(message))) {
+        // The I/O thread is behind; it only moves messages into its own queue.
+        wakeIOThread();
+        std::this_thread::yield();
+    }
+    wakeIOThread();
+}
+
+void VHTCPSink::wakeIOThread() {
+
+    // At most one drain is posted at a time, however many batches arrive meanwhile.
+    if (!drainScheduled_.exchange(true, std::memory_order_acq_rel)) {
+        asio::post(ioContext_, [this]() { drainPendingMessages(); });
+    }
+}
+
+void VHTCPSink::drainPendingMessages() {
+
+    // Cleared first, so a message pushed after the last pop below posts a new drain.
+    drainScheduled_.exchange(false, std::memory_order_acq_rel);
+    TCPMessage message;
+    while (pendingMessages_.tryPop(message)) {
+        if (!shutdownSocket_) {
+            queueTCPMessage(std::move(message));
+        }
+    }
+    if (!shutdownSocket_ && !tcpIsSending_) {
+        sendNextTCPMessage();
+    }
+}
+
+void VHTCPSink::queueTCPMessage(TCPMessage message) {
+
+    bool sameOwner = !tcpMessageQueue_.empty() && tcpMessageQueue_.back().owner == message.owner;
+    message.charge = sameOwner ? 0 : ownerCharge(message);
+    if (!spooling_ && queuedBytes_ + message.charge <= maxQueueBytes_) {
+        queuedBytes_ += message.charge;
+        tcpMessageQueue_.push_back(std::move(message));
+        return;
+    }
+    if (!spoolTCPMessage(message.text)) {
+        droppedLines_ += static_cast<std::uint64_t>(std::count(message.text.begin(), message.text.end(), '\n'));
+    }
+}
+
+std::size_t VHTCPSink::ownerCharge(const TCPMessage& message) {
+
+    return std::max(message.owner->capacity(), message.text.size());
+}
+
+// Called for a message leaving the queue: the next one keeps the charge while it still
+// pins the same owner.
+void VHTCPSink::releaseQueuedCharge(std::size_t charge, const std::shared_ptr<const std::string>& owner) {
+
+    if (!tcpMessageQueue_.empty() && tcpMessageQueue_.front().owner == owner) {
+        tcpMessageQueue_.front().charge += charge;
+    }
+    else {
+        queuedBytes_ -= charge;
+    }
+}
+
+// Returns the first message of a gathered write the peer did not get completely. Of a
+// message cut off midway only the rest remains in it.
+std::vector<VHTCPSink::TCPMessage>::iterator VHTCPSink::skipSent(std::vector<TCPMessage>& messages,
+                                                                 std::size_t bytesWritten) {
+
+    auto unsent = messages.begin();
+    while (unsent != messages.end() && bytesWritten >= unsent->text.size()) {
+        bytesWritten -= unsent->text.size();
+        ++unsent;
+    }
+    if (unsent != messages.end()) {
+        unsent->text.remove_prefix(bytesWritten);
+    }
+    return unsent;
+}
+
+bool VHTCPSink::spoolTCPMessage(std::string_view message) {
+
+    if (spoolPath_.empty()) {
+        return false;
+    }
+    if (!spoolOut_.is_open()) {
+        spoolOut_.clear();
+        spoolOut_.open(spoolPath_, std::ios::binary | std::ios::app);
+    }
+    spoolOut_.write(message.data(), static_cast<std::streamsize>(message.size()));
+    if (!spoolOut_) {
+        std::println("Failed to write to TCP spool file: {}", spoolPath_);
+        spoolOut_.close();
+        return false;
+    }
+    spooling_ = true;
+    return true;
+}
+
+bool VHTCPSink::loadSpoolChunk() {
+
+    spoolOut_.flush();
+    // The receiver sees a byte stream, so chunks do not need to end on a line.
+    auto chunk = std::make_shared<std::string>(MAX_SEND_BYTES, '\0');
+    std::ifstream spoolIn(spoolPath_, std::ios::binary);
+    if (spoolIn.seekg(static_cast<std::streamoff>(spoolReadOffset_))) {
+        spoolIn.read(chunk->data(), static_cast<std::streamsize>(chunk->size()));
+    }
+    chunk->resize(static_cast<std::size_t>(std::max<std::streamsize>(spoolIn.gcount(), 0)));
+    if (chunk->empty()) {
+        // Replayed completely, new lines can use the queue again.
+        spoolIn.close();
+        spoolOut_.close();
+        std::error_code error;
+        std::filesystem::remove(spoolPath_, error);
+        spoolReadOffset_ = 0;
+        spooling_ = false;
+        return false;
+    }
+    spoolReadOffset_ += chunk->size();
+    queuedBytes_ += chunk->capacity();
+    std::string_view view(*chunk);
+    std::size_t charge = chunk->capacity();
+    tcpMessageQueue_.push_back(TCPMessage{std::move(chunk), view, charge});
+    return true;
+}
+
+// Runs once the I/O thread is gone. Everything not delivered is written to the spool
+// in send order, ahead of the lines spooled but not replayed yet, so the next run
+// sends it; the part of the spool already replayed is left out. Without a spool file
+// the lines are counted as dropped.
+void VHTCPSink::spoolUnsentMessages() {
+
+    std::vector<TCPMessage> unsent = std::move(sendingMessages_);
+    unsent.insert(unsent.end(), std::make_move_iterator(tcpMessageQueue_.begin()),
+                  std::make_move_iterator(tcpMessageQueue_.end()));
+    tcpMessageQueue_.clear();
+    // Handed over by the logger thread but never drained, newer than the spool.
+    std::vector<TCPMessage> pending;
+    TCPMessage message;
+    while (pendingMessages_.tryPop(message)) {
+        pending.push_back(std::move(message));
+    }
+
+    if (spoolPath_.empty()) {
+        for (const auto* messages : {&unsent, &pending}) {
+            for (const auto& dropped : *messages) {
+                droppedLines_ += static_cast<std::uint64_t>(std::count(dropped.text.begin(), dropped.text.end(), '\n'));
+            }
+        }
+        if (droppedLines_ > 0) {
+            std::println("TCP sink dropped {} lines for {}:{} that were not sent by shutdown", droppedLines_,
+                         hostIpAddress_, hostPort_);
+        }
+        return;
+    }
+    if (unsent.empty() && pending.empty() && spoolReadOffset_ == 0) {
+        // The spool, if any, holds exactly what is left.
+        return;
+    }
+
+    spoolOut_.close();
+    std::string rewrittenPath = spoolPath_ + ".tmp";
+    std::ofstream rewritten(rewrittenPath, std::ios::binary | std::ios::trunc);
+    for (const auto& left : unsent) {
+        rewritten.write(left.text.data(), static_cast<std::streamsize>(left.text.size()));
+    }
+    std::ifstream spoolIn(spoolPath_, std::ios::binary);
+    if (spoolIn.seekg(static_cast<std::streamoff>(spoolReadOffset_)) &&
+        spoolIn.peek() != std::ifstream::traits_type::eof()) {
+        rewritten << spoolIn.rdbuf();
+    }
+    spoolIn.close();
+    for (const auto& left : pending) {
+        rewritten.write(left.text.data(), static_cast<std::streamsize>(left.text.size()));
+    }
+    rewritten.close();
+
+    std::error_code error;
+    if (!rewritten) {
+        std::println("Failed to write to TCP spool file: {}", rewrittenPath);
+        std::filesystem::remove(rewrittenPath, error);
+        return;
+    }
+    if (std::filesystem::file_size(rewrittenPath, error) == 0 && !error) {
+        std::filesystem::remove(rewrittenPath, error);
+        std::filesystem::remove(spoolPath_, error);
+        return;
+    }
+    std::filesystem::rename(rewrittenPath, spoolPath_, error);
+    if (error) {
+        std::println("Failed to replace TCP spool file: {}", spoolPath_);
+    }
+}
+
+void VHTCPSink::connectTCPSink() {
+    if (shutdownSocket_) {
+        return;
+    }
+
+    if (reconnectTimer_) {
+        reconnectTimer_->cancel();
+    }
+    reconnectPending_ = false;
+
+    std::error_code ec;
+    asio::error_code res;
+
+    if (socket_.is_open()) {
+        res = socket_.close(ec);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(socketMutex_);
+        socketConnected_ = false;
+    }
+    
+    tcpIsSending_ = false;
+    
+    asio::ip::tcp::resolver resolver(ioContext_);
+    auto endpoints = resolver.resolve(hostIpAddress_, std::to_string(hostPort_), ec);
+    
+    if (ec) {
+        if (!shutdownSocket_) {
+            scheduleReconnectTCPSink();
+        }
+        return;
+    }
+    
+    asio::async_connect(socket_, endpoints, 
+        [this](std::error_code ec, asio::ip::tcp::endpoint endpoint) {
+            if (shutdownSocket_.load(std::memory_order_acquire)) { 
+                return;
+            }
+            if (!ec) {
+                std::lock_guard<std::mutex> lock(socketMutex_);
+                socketConnected_ = true;
+                reconnectAttempts_ = 0;
+                if (droppedLines_ > 0) {
+                    std::println("TCP sink dropped {} lines while {}:{} was unreachable", droppedLines_,
+                                 hostIpAddress_, hostPort_);
+                    droppedLines_ = 0;
+                }
+                
+                asio::socket_base::keep_alive option(true);
+                socket_.set_option(option);
+                
+                startReadingForDisconnects();
+                
+                asio::post(ioContext_, [this]() {
+                    if ((!tcpMessageQueue_.empty() || spooling_) && !tcpIsSending_) {
+                        sendNextTCPMessage();
+                    }
+                });
+            } 
+            else {
+                if (!shutdownSocket_) {
+                    scheduleReconnectTCPSink();
+                }
+            }
+        }
+    );
+}
+
+void VHTCPSink::sendNextTCPMessage() {
+    if (shutdownSocket_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(socketMutex_);
+        tcpIsSending_ = false;
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(socketMutex_, std::try_to_lock);
+    if (!lock.owns_lock() || tcpIsSending_) {
+        return;
+    }
+    
+    if (tcpMessageQueue_.empty() && spooling_ && socketConnected_) {
+        loadSpoolChunk();
+    }
+    // Whatever noticed the disconnect has scheduled the reconnect already.
+    if (tcpMessageQueue_.empty() || !socketConnected_) {
+        tcpIsSending_ = false;
+        return;
+    }
+    
+    tcpIsSending_ = true;
+    // Everything queued, up to MAX_SEND_BYTES, goes out in one gathered write.
+    std::size_t sendBytes = 0;
+    while (!tcpMessageQueue_.empty() &&
+           (sendingMessages_.empty() || sendBytes + tcpMessageQueue_.front().text.size() <= MAX_SEND_BYTES)) {
+        sendBytes += tcpMessageQueue_.front().text.size();
+        sendingMessages_.push_back(std::move(tcpMessageQueue_.front()));
+        tcpMessageQueue_.pop_front();
+        TCPMessage& sent = sendingMessages_.back();
+        releaseQueuedCharge(std::exchange(sent.charge, 0), sent.owner);
+    }
+    
+    if (shutdownSocket_.load(std::memory_order_acquire)) {
+        // Left to spoolUnsentMessages().
+        tcpIsSending_ = false;
+        return;
+    }
+    
+    sendBuffers_.clear();
+    for (const auto& message : sendingMessages_) {
+        sendBuffers_.push_back(asio::buffer(message.text.data(), message.text.size()));
+    }
+    
+    asio::async_write(socket_, sendBuffers_,
+        [this](std::error_code ec, size_t bytes_written) {
+            if (shutdownSocket_.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(socketMutex_);
+                // The rest is left to spoolUnsentMessages().
+                sendingMessages_.erase(sendingMessages_.begin(), skipSent(sendingMessages_, bytes_written));
+                tcpIsSending_ = false;
+                return;
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(socketMutex_);
+                tcpIsSending_ = false;
+            }
+            
+            if (ec) {
+                if (!shutdownSocket_.load(std::memory_order_acquire)) {
+                    std::lock_guard<std::mutex> lock(socketMutex_);
+                    if (!shutdownSocket_.load(std::memory_order_acquire)) {
+                        // Resend whatever did not make it out, ahead of newer messages. Of a
+                        // message cut off midway only the rest goes again, the receiver has
+                        // the start already.
+                        auto unsent = skipSent(sendingMessages_, bytes_written);
+                        // Charge the requeued runs again, unless the queue front already
+                        // carries the charge for the same owner.
+                        const std::string* frontOwner =
+                            tcpMessageQueue_.empty() ? nullptr : tcpMessageQueue_.front().owner.get();
+                        const std::string* previousOwner = nullptr;
+                        for (auto it = unsent; it != sendingMessages_.end(); ++it) {
+                            bool charged = it->owner.get() == previousOwner || it->owner.get() == frontOwner;
+                            it->charge = charged ? 0 : ownerCharge(*it);
+                            queuedBytes_ += it->charge;
+                            previousOwner = it->owner.get();
+                        }
+                        tcpMessageQueue_.insert(tcpMessageQueue_.begin(), std::make_move_iterator(unsent),
+                                                std::make_move_iterator(sendingMessages_.end()));
+                        sendingMessages_.clear();
+                        
+                        std::error_code ignored_ec;
+                        socket_.close(ignored_ec);
+                        socketConnected_ = false;
+                        
+                        if (!shutdownSocket_.load(std::memory_order_acquire)) {
+                            scheduleReconnectTCPSink();
+                        }
+                    }
+                }
+            } 
+            else {
+                sendingMessages_.clear();
+                if (!shutdownSocket_.load(std::memory_order_acquire)) {
+                    bool connected = false;
+                    bool hasMore = false;
+                    {
+                        std::lock_guard<std::mutex> lock(socketMutex_);
+                        connected = socketConnected_;
+                        hasMore = !tcpMessageQueue_.empty() || spooling_;
+                    }
+                    
+                    if (hasMore && connected) {
+                        asio::post(ioContext_, [this]() {
+                            if (!shutdownSocket_.load(std::memory_order_acquire)) {
+                                sendNextTCPMessage();
+                            }
+                        });
+                    }
+                }
+            }
+        }
+    );
+}
+
+void VHTCPSink::startReadingForDisconnects() {
+    if (shutdownSocket_) {
+        return;
+    }
+        
+    socket_.async_read_some(
+        asio::buffer(readBuffer_), [this](std::error_code ec, std::size_t bytes_read) {
+            if (ec) {
+                if (ec != asio::error::operation_aborted) {
+                    {
+                        std::lock_guard<std::mutex> lock(socketMutex_);
+                        socketConnected_ = false;
+                        tcpIsSending_ = false;
+                    }
+                        
+                    if (!shutdownSocket_) {
+                        scheduleReconnectTCPSink();
+                    }
+                }
+            }
+            else {
+                startReadingForDisconnects();
+            }
+        }
+    );
+}
+
+void VHTCPSink::scheduleReconnectTCPSink() {
+    if (!reconnectTimer_ || shutdownSocket_ || reconnectPending_) {
+        return;
+    }
+    
+    // Exponential backoff; the jitter keeps clients of a restarted collector from all
+    // coming back at the same moment.
+    auto ceiling = std::min<std::chrono::milliseconds>(MAX_RECONNECT_DELAY,
+                                                       MIN_RECONNECT_DELAY * (1 << std::min(reconnectAttempts_, 16u)));
+    ++reconnectAttempts_;
+    std::uniform_int_distribution<long long> jitter(ceiling.count() / 2, ceiling.count());
+    reconnectPending_ = true;
+    reconnectTimer_->expires_after(std::chrono::milliseconds(jitter(random_)));
+    reconnectTimer_->async_wait(
+        [this](std::error_code ec) { 
+            if (ec) {
+                return;
+            }
+            
+            if (shutdownSocket_) { 
+                return;
+            }
+            
+            connectTCPSink(); 
+        }
+    );
+}
+
+#endif
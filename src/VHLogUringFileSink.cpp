@@ -0,0 +1,423 @@
+#include "VHLogUringFileSink.h"
+#include <algorithm>
+#include <print>
+#include <utility>
+
+#ifdef VHLOG_HAS_IO_URING
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint64_t SYNC_USER_DATA = ~std::uint64_t{0};
+
+int uringSetup(unsigned entries, io_uring_params& params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int uringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int uringRegister(int ringFd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+
+// Synchronous fallback used for oversized lines and to finish short completions.
+bool writeAt(int fd, std::string_view data, std::uint64_t offset) {
+
+    while (!data.empty()) {
+        ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+        offset += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+}
+
+// The three shared mappings of one ring. Only the logger thread submits and reaps, so
+// the kernel is the only other party touching the head and tail indices.
+struct VHUringFileSink::Ring {
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    std::size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;
+    std::size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqEntries = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    bool syncInFlight = false;
+    bool dirty = false;
+
+    ~Ring() {
+
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            ::munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            ::munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool open(unsigned entries) {
+
+        io_uring_params params{};
+        fd = uringSetup(entries, params);
+        if (fd < 0) {
+            return false;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = singleMmap ? sqRing :
+            ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sqEntries = params.sq_entries;
+        auto* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Queues one entry and submits it right away. At most bufferCount writes and one
+    // sync are ever in flight and the ring has room for more, so it cannot be full.
+    // False when the kernel did not take the entry; it is then removed from the ring
+    // again, so it cannot go out with a later submit once its buffer was reused.
+    bool submit(const io_uring_sqe& entry) {
+
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        sqes[index] = entry;
+        sqArray[index] = index;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        for (;;) {
+            int submitted = uringEnter(fd, 1, 0, 0);
+            if (submitted > 0) {
+                return true;
+            }
+            if (submitted < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+                continue;
+            }
+            break;
+        }
+        // The kernel consumed the entry after all if the head moved past it, its
+        // completion will follow.
+        if (std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire) != tail) {
+            return true;
+        }
+        std::atomic_ref<unsigned>(*sqTail).store(tail, std::memory_order_release);
+        return false;
+    }
+};
+
+VHUringFileSink::VHUringFileSink(const std::string& basePathAndName, std::size_t maxSize,
+                                 std::size_t bufferSize, std::size_t bufferCount,
+                                 std::chrono::milliseconds syncInterval) :
+    VHFileSink(basePathAndName, maxSize, bufferSize),
+    nextOffset_(0),
+    pending_(0),
+    syncInterval_(syncInterval),
+    lastSync_(std::chrono::steady_clock::now()) {
+
+    if (initRing(std::max<std::size_t>(bufferCount, 1)) && fd_ >= 0) {
+        // The base constructor opened the file before this object's hooks existed.
+        fileOpened();
+    }
+}
+
+VHUringFileSink::~VHUringFileSink() {
+
+    writeBuffer();
+    drain();
+}
+
+bool VHUringFileSink::initRing(std::size_t bufferCount) {
+
+    auto ring = std::make_unique<Ring>();
+    if (!ring->open(static_cast<unsigned>(bufferCount * 2 + 2))) {
+        std::println("io_uring unavailable, log file {} uses plain writes", basePathAndName_);
+        return false;
+    }
+
+    slots_.resize(bufferCount);
+    std::vector<iovec> buffers;
+    buffers.reserve(bufferCount + 1);
+    buffers.push_back(iovec{buffer_.data(), bufferSize_});
+    for (auto& slot : slots_) {
+        slot.data.reserve(bufferSize_);
+        buffers.push_back(iovec{slot.data.data(), bufferSize_});
+    }
+    // Registration pins the pages and can fail against RLIMIT_MEMLOCK; plain
+    // IORING_OP_WRITE still keeps the I/O off the logger thread.
+    if (uringRegister(ring->fd, IORING_REGISTER_BUFFERS, buffers.data(),
+                      static_cast<unsigned>(buffers.size())) == 0) {
+        for (const auto& buffer : buffers) {
+            registeredData_.push_back(static_cast<const char*>(buffer.iov_base));
+        }
+    }
+    ring_ = std::move(ring);
+    return true;
+}
+
+int VHUringFileSink::registeredIndex(const char* data) const {
+
+    auto it = std::find(registeredData_.begin(), registeredData_.end(), data);
+    return it == registeredData_.end() ? -1 : static_cast<int>(it - registeredData_.begin());
+}
+
+void VHUringFileSink::fileOpened() {
+
+    if (!ring_) {
+        return;
+    }
+    // Writes carry explicit offsets so several can be in flight; O_APPEND would make
+    // the kernel ignore them.
+    int flags = ::fcntl(fd_, F_GETFL);
+    if (flags >= 0) {
+        ::fcntl(fd_, F_SETFL, flags & ~O_APPEND);
+    }
+    off_t end = ::lseek(fd_, 0, SEEK_END);
+    nextOffset_ = end < 0 ? 0 : static_cast<std::uint64_t>(end);
+}
+
+void VHUringFileSink::fileClosing() {
+
+    drain();
+}
+
+void VHUringFileSink::syncFile() {
+
+    // fdatasync only covers writes that completed.
+    drain();
+    VHFileSink::syncFile();
+}
+
+VHUringFileSink::Slot& VHUringFileSink::acquireSlot() {
+
+    reapCompletions(0);
+    for (;;) {
+        for (auto& slot : slots_) {
+            if (!slot.inFlight) {
+                return slot;
+            }
+        }
+        reapCompletions(1);
+    }
+}
+
+void VHUringFileSink::submitWrite(Slot& slot, std::size_t slotIndex) {
+
+    io_uring_sqe entry{};
+    int bufferIndex = registeredIndex(slot.data.data());
+    entry.opcode = bufferIndex >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    entry.fd = fd_;
+    entry.addr = reinterpret_cast<std::uint64_t>(slot.data.data());
+    entry.len = static_cast<std::uint32_t>(slot.data.size());
+    entry.off = slot.offset;
+    entry.buf_index = static_cast<std::uint16_t>(std::max(bufferIndex, 0));
+    entry.user_data = slotIndex;
+
+    if (!ring_->submit(entry)) {
+        if (!writeAt(fd_, slot.data, slot.offset)) {
+            std::println("Failed to write to log file: {}", basePathAndName_);
+        }
+        slot.data.clear();
+        return;
+    }
+    slot.inFlight = true;
+    ++pending_;
+    ring_->dirty = true;
+}
+
+void VHUringFileSink::submitSync() {
+
+    io_uring_sqe entry{};
+    entry.opcode = IORING_OP_FSYNC;
+    // Drain orders the sync after every write queued before it.
+    entry.flags = IOSQE_IO_DRAIN;
+    entry.fd = fd_;
+    entry.fsync_flags = IORING_FSYNC_DATASYNC;
+    entry.user_data = SYNC_USER_DATA;
+    if (ring_->submit(entry)) {
+        ring_->syncInFlight = true;
+        ring_->dirty = false;
+        ++pending_;
+    }
+    lastSync_ = std::chrono::steady_clock::now();
+}
+
+void VHUringFileSink::reapCompletions(unsigned waitFor) {
+
+    if (waitFor > 0 && pending_ > 0) {
+        while (uringEnter(ring_->fd, 0, waitFor, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {
+        }
+    }
+    unsigned head = *ring_->cqHead;
+    unsigned tail = std::atomic_ref<unsigned>(*ring_->cqTail).load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& completion = ring_->cqes[head & *ring_->cqMask];
+        --pending_;
+        if (completion.user_data == SYNC_USER_DATA) {
+            ring_->syncInFlight = false;
+            continue;
+        }
+        Slot& slot = slots_[completion.user_data];
+        std::string_view rest(slot.data);
+        if (completion.res >= 0) {
+            rest.remove_prefix(std::min(rest.size(), static_cast<std::size_t>(completion.res)));
+        }
+        // Short or interrupted writes are finished in place; the offset keeps the
+        // file contiguous whatever else is in flight.
+        if (!rest.empty() && !writeAt(fd_, rest, slot.offset + (slot.data.size() - rest.size()))) {
+            std::println("Failed to write to log file: {}", basePathAndName_);
+        }
+        slot.data.clear();
+        slot.inFlight = false;
+    }
+    std::atomic_ref<unsigned>(*ring_->cqHead).store(head, std::memory_order_release);
+}
+
+void VHUringFileSink::drain() {
+
+    while (ring_ && pending_ > 0) {
+        reapCompletions(1);
+    }
+}
+
+void VHUringFileSink::writeBuffer(std::string_view extra) {
+
+    if (!ring_) {
+        VHFileSink::writeBuffer(extra);
+        return;
+    }
+    if (fd_ < 0) {
+        buffer_.clear();
+        return;
+    }
+
+    for (int part = 0; part < 2; ++part) {
+        if (part == 1) {
+            if (extra.empty()) {
+                break;
+            }
+            if (extra.size() > bufferSize_) {
+                // Larger than any buffer: write it synchronously once the rest has landed.
+                drain();
+                if (!writeAt(fd_, extra, nextOffset_)) {
+                    std::println("Failed to write to log file: {}", basePathAndName_);
+                }
+                nextOffset_ += extra.size();
+                break;
+            }
+            buffer_.append(extra);
+        }
+        if (buffer_.empty()) {
+            continue;
+        }
+        Slot& slot = acquireSlot();
+        std::swap(slot.data, buffer_);
+        slot.offset = nextOffset_;
+        nextOffset_ += slot.data.size();
+        submitWrite(slot, static_cast<std::size_t>(&slot - slots_.data()));
+    }
+
+    if (syncInterval_.count() > 0 && ring_->dirty && !ring_->syncInFlight &&
+        std::chrono::steady_clock::now() - lastSync_ >= syncInterval_) {
+        submitSync();
+    }
+}
+
+#else
+
+struct VHUringFileSink::Ring {};
+
+VHUringFileSink::VHUringFileSink(const std::string& basePathAndName, std::size_t maxSize,
+                                 std::size_t bufferSize, std::size_t,
+                                 std::chrono::milliseconds syncInterval) :
+    VHFileSink(basePathAndName, maxSize, bufferSize),
+    nextOffset_(0),
+    pending_(0),
+    syncInterval_(syncInterval) {
+}
+
+VHUringFileSink::~VHUringFileSink() {
+
+    VHFileSink::writeBuffer();
+}
+
+bool VHUringFileSink::initRing(std::size_t) { return false; }
+int VHUringFileSink::registeredIndex(const char*) const { return -1; }
+void VHUringFileSink::fileOpened() {}
+void VHUringFileSink::fileClosing() {}
+
+void VHUringFileSink::syncFile() {
+
+    VHFileSink::syncFile();
+}
+VHUringFileSink::Slot& VHUringFileSink::acquireSlot() { return slots_.front(); }
+void VHUringFileSink::submitWrite(Slot&, std::size_t) {}
+void VHUringFileSink::submitSync() {}
+void VHUringFileSink::reapCompletions(unsigned) {}
+void VHUringFileSink::drain() {}
+
+void VHUringFileSink::writeBuffer(std::string_view extra) {
+
+    VHFileSink::writeBuffer(extra);
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "VHLogFileSink.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Checks that with VHLogDurability::SyncInterval every fdatasync covers all lines the
+// sink was given before it: the logger thread writes its buffer out before handing a
+// due sync to the helper, and does not leave one to the helper while lines are still
+// buffered. fdatasync is replaced below to record the file's on-disk length each time.
+
+static std::atomic<int> g_syncs{0};
+static std::atomic<long long> g_short_syncs{0};
+static std::atomic<long long> g_bytes_given{0};
+
+extern "C" int fdatasync(int fd) {
+
+    struct stat status {};
+    if (::fstat(fd, &status) == 0 && status.st_size < g_bytes_given.load()) {
+        g_short_syncs.fetch_add(1);
+    }
+    g_syncs.fetch_add(1);
+    return static_cast<int>(::syscall(SYS_fdatasync, fd));
+}
+
+static const std::chrono::milliseconds sync_interval(200);
+
+// Hands lines to the sink directly, the way the logger thread does after a batch.
+void write_lines(VHFileSink& sink, int first, int count) {
+
+    std::vector<std::string> lines;
+    std::vector<VHLogRecord> records;
+    for (int i = first; i < first + count; ++i) {
+        lines.push_back("line " + std::to_string(i) + "\n");
+    }
+    for (const auto& line : lines) {
+        records.push_back(VHLogRecord{VHLogLevel::INFOLV, std::chrono::system_clock::now(), line, line,
+                                      {}, nullptr, {}, {}, 0});
+        g_bytes_given.fetch_add(static_cast<long long>(line.size()));
+    }
+    sink.write(records);
+}
+
+long long on_disk_size(const std::filesystem::path& directory) {
+
+    long long size = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        size += static_cast<long long>(entry.file_size());
+    }
+    return size;
+}
+
+int main() {
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "vhlog_sync_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    bool passed = true;
+    {
+        // A buffer far larger than the lines, so only the sink decides when they go out.
+        VHFileSink sink((directory / "sync").string(), 64 * 1024 * 1024, VHFileSink::MAX_BUFFER_SIZE);
+        sink.setDurabilityPolicy({VHLogDurability::SyncInterval, sync_interval});
+
+        // The first batch is due right away, the next ones within the interval stay
+        // buffered across the due time of the following sync.
+        write_lines(sink, 0, 100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (int round = 1; round <= 5; ++round) {
+            write_lines(sink, round * 1000, 100);
+            std::this_thread::sleep_for(sync_interval + std::chrono::milliseconds(50));
+            write_lines(sink, round * 1000 + 500, 100);
+            // That batch found the sync due: its lines and the buffered ones are in the
+            // file before the helper gets to sync it.
+            long long size = on_disk_size(directory);
+            if (size != g_bytes_given.load()) {
+                std::cout << "Round " << round << ": " << size << " bytes on disk after a due sync, "
+                          << g_bytes_given.load() << " given" << std::endl;
+                passed = false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    std::filesystem::remove_all(directory);
+
+    std::cout << g_syncs.load() << " syncs, " << g_short_syncs.load() << " missed buffered lines" << std::endl;
+    return passed && g_syncs.load() > 0 && g_short_syncs.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "VHLog.h"
+#include "VHLogMappedFileSink.h"
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+
+// Checks how VHMappedFileSink handles a failing posix_fallocate. The function is
+// replaced below so each case can pick the error: a file system that cannot
+// preallocate still gets a (sparse) mapping, any other error such as a full disk must
+// leave the sink on write(), since stores into unbacked pages would raise SIGBUS.
+
+static int g_fallocate_result = 0;
+
+extern "C" int posix_fallocate(int, off_t, off_t) {
+    return g_fallocate_result;
+}
+
+static const int lines = 1000;
+
+// Logs lines through a fresh sink with posix_fallocate failing as given, then checks
+// the mapping state and that every line made it into the file.
+bool check_fallocate_error(int error, bool expect_mapping) {
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "vhlog_mapped_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    g_fallocate_result = error;
+
+    auto sink = std::make_shared<VHMappedFileSink>((directory / "mapped").string(), 1024 * 1024);
+    bool mapped = sink->usingMapping();
+    {
+        VHLogger logger(false, 64);
+        logger.addSink(sink);
+        for (int i = 0; i < lines; ++i) {
+            logger.log(VHLogLevel::INFOLV, "line {}", i);
+        }
+    }
+    sink.reset();
+
+    std::string content;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::ifstream file(entry.path(), std::ios::binary);
+        content.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::size_t found = 0;
+    for (int i = 0; i < lines; ++i) {
+        if (content.find("line " + std::to_string(i) + "\n") != std::string::npos) {
+            ++found;
+        }
+    }
+    std::filesystem::remove_all(directory);
+
+    bool passed = mapped == expect_mapping && found == lines && content.find('\0') == std::string::npos;
+    std::cout << "posix_fallocate error " << error << ": mapping " << mapped << ", " << found << " of "
+              << lines << " lines" << (passed ? "" : " FAILED") << std::endl;
+    return passed;
+}
+
+int main() {
+
+    bool passed = check_fallocate_error(EOPNOTSUPP, true);
+    passed &= check_fallocate_error(EINVAL, true);
+    passed &= check_fallocate_error(ENOSPC, false);
+    passed &= check_fallocate_error(EIO, false);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+// vhlog-decode: prints VHBinaryFileSink files as the text sinks would have written them.
+//
+//   vhlog-decode [--precision s|ms|us|ns] file.vhlb...
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "VHLogBinary.h"
+#include "VHLogRecord.h"
+
+namespace {
+
+using Arg = std::variant<bool, char, std::int64_t, std::uint64_t, float, double, const void*, std::string_view>;
+
+struct Format {
+    std::string text;
+    std::string types;
+};
+
+template <typename T>
+T readValue(const char* in) {
+
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    return value;
+}
+
+Arg decodeArg(char tag, const char* in) {
+
+    switch (tag) {
+        case 'b': return readValue<bool>(in);
+        case 'c': return readValue<char>(in);
+        case 'a': return static_cast<std::int64_t>(readValue<std::int8_t>(in));
+        case 'h': return static_cast<std::int64_t>(readValue<std::int16_t>(in));
+        case 'i': return static_cast<std::int64_t>(readValue<std::int32_t>(in));
+        case 'l': return readValue<std::int64_t>(in);
+        case 'A': return static_cast<std::uint64_t>(readValue<std::uint8_t>(in));
+        case 'H': return static_cast<std::uint64_t>(readValue<std::uint16_t>(in));
+        case 'I': return static_cast<std::uint64_t>(readValue<std::uint32_t>(in));
+        case 'L': return readValue<std::uint64_t>(in);
+        case 'f': return readValue<float>(in);
+        case 'd': return readValue<double>(in);
+        case 'p': return readValue<const void*>(in);
+        default:
+            return std::string_view(in + sizeof(std::uint32_t), readValue<std::uint32_t>(in));
+    }
+}
+
+// The argument count is only known at run time, so every replacement field is
+// formatted on its own against a one-argument format string.
+void formatMessage(std::string& out, std::string_view format, const std::vector<Arg>& args) {
+
+    std::size_t nextArg = 0;
+    for (std::size_t i = 0; i < format.size(); ++i) {
+        char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+            out += c;
+            ++i;
+            continue;
+        }
+        if (c != '{') {
+            out += c;
+            continue;
+        }
+        std::size_t close = format.find('}', i);
+        if (close == std::string_view::npos) {
+            out.append(format.substr(i));
+            return;
+        }
+        std::string_view field = format.substr(i + 1, close - i - 1);
+        std::size_t colon = field.find(':');
+        std::string_view index = field.substr(0, colon);
+        std::size_t argIndex = nextArg++;
+        if (!index.empty()) {
+            argIndex = 0;
+            for (char digit : index) {
+                argIndex = argIndex * 10 + static_cast<std::size_t>(digit - '0');
+            }
+        }
+        std::string pattern = "{";
+        if (colon != std::string_view::npos) {
+            pattern += field.substr(colon);
+        }
+        pattern += '}';
+        try {
+            if (argIndex >= args.size()) {
+                throw std::format_error("missing argument");
+            }
+            std::visit([&out, &pattern](const auto& value) {
+                std::vformat_to(std::back_inserter(out), pattern, std::make_format_args(value));
+            }, args[argIndex]);
+        }
+        catch (const std::format_error&) {
+            // Nested replacement fields and the like, keep the field as written.
+            out.append(format.substr(i, close - i + 1));
+        }
+        i = close;
+    }
+}
+
+class Decoder {
+public:
+    explicit Decoder(int fractionDigits) :
+        fractionDigits_(fractionDigits),
+        timeZone_(std::chrono::current_zone()) {
+    }
+
+    bool decode(std::string_view data, const std::string& fileName) {
+
+        const char* in = data.data();
+        const char* end = in + data.size();
+        bool haveHeader = false;
+        while (in != end) {
+            // A file reopened within the same second continues with a new header.
+            if (end - in >= static_cast<std::ptrdiff_t>(VHLOG_BINARY_HEADER_SIZE) &&
+                std::memcmp(in, VHLOG_BINARY_MAGIC, sizeof(VHLOG_BINARY_MAGIC)) == 0) {
+                if (!readHeader(in, fileName)) {
+                    return false;
+                }
+                haveHeader = true;
+                continue;
+            }
+            if (!haveHeader || !readFrame(in, end)) {
+                std::println(stderr, "{}: corrupt data at offset {}", fileName, in - data.data());
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool readHeader(const char*& in, const std::string& fileName) {
+
+        auto version = static_cast<std::uint8_t>(in[sizeof(VHLOG_BINARY_MAGIC)]);
+        bool littleEndian = in[sizeof(VHLOG_BINARY_MAGIC) + 1] == 1;
+        if (version != VHLOG_BINARY_VERSION) {
+            std::println(stderr, "{}: unsupported version {}", fileName, version);
+            return false;
+        }
+        if (littleEndian != (std::endian::native == std::endian::little)) {
+            std::println(stderr, "{}: written on a machine with a different byte order", fileName);
+            return false;
+        }
+        timestamp_ = readValue<std::int64_t>(in + sizeof(VHLOG_BINARY_MAGIC) + 2);
+        formats_.clear();
+        in += VHLOG_BINARY_HEADER_SIZE;
+        return true;
+    }
+
+    bool readFrame(const char*& in, const char* end) {
+
+        auto tag = static_cast<std::uint8_t>(*in++);
+        auto kind = static_cast<VHLogBinaryFrame>(tag >> 4);
+        auto level = static_cast<VHLogLevel>(tag & 0x0f);
+        std::uint64_t id = 0;
+        std::uint64_t length = 0;
+        std::int64_t delta = 0;
+
+        switch (kind) {
+            case VHLogBinaryFrame::Format: {
+                if (!vhlogGetVarint(in, end, id) || !vhlogGetVarint(in, end, length) ||
+                    static_cast<std::uint64_t>(end - in) < length) {
+                    return false;
+                }
+                Format format;
+                format.text.assign(in, length);
+                in += length;
+                if (!vhlogGetVarint(in, end, length) || static_cast<std::uint64_t>(end - in) < length) {
+                    return false;
+                }
+                format.types.assign(in, length);
+                in += length;
+                if (formats_.size() <= id) {
+                    formats_.resize(id + 1);
+                }
+                formats_[id] = std::move(format);
+                return true;
+            }
+            case VHLogBinaryFrame::Message: {
+                if (!vhlogGetSignedVarint(in, end, delta) || !vhlogGetVarint(in, end, id) || id >= formats_.size()) {
+                    return false;
+                }
+                const Format& format = formats_[id];
+                args_.clear();
+                for (char type : format.types) {
+                    std::size_t size = vhlogEncodedArgSize(type, in, end);
+                    if (size == 0) {
+                        return false;
+                    }
+                    args_.push_back(decodeArg(type, in));
+                    in += size;
+                }
+                message_.clear();
+                formatMessage(message_, format.text, args_);
+                break;
+            }
+            case VHLogBinaryFrame::Text: {
+                if (!vhlogGetSignedVarint(in, end, delta) || !vhlogGetVarint(in, end, length) ||
+                    static_cast<std::uint64_t>(end - in) < length) {
+                    return false;
+                }
+                message_.assign(in, length);
+                in += length;
+                break;
+            }
+            default:
+                return false;
+        }
+
+        timestamp_ += delta;
+        line_.clear();
+        appendTimestamp(line_);
+        line_ += " [";
+        line_ += vhlogLevelName(level);
+        line_ += "] ";
+        line_ += message_;
+        line_ += '\n';
+        std::fwrite(line_.data(), 1, line_.size(), stdout);
+        return true;
+    }
+
+    // Same layout as VHLogger::appendTimestamp.
+    void appendTimestamp(std::string& out) {
+
+        auto time = std::chrono::sys_time<std::chrono::nanoseconds>(std::chrono::nanoseconds(timestamp_));
+        auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+        out += std::format("[{:%Y-%m-%d_%H-%M:%S}", std::chrono::zoned_time(timeZone_, seconds));
+        if (fractionDigits_ > 0) {
+            auto fraction = static_cast<std::uint64_t>((time - seconds).count());
+            for (int i = fractionDigits_; i < 9; ++i) {
+                fraction /= 10;
+            }
+            out += std::format(".{:0{}}", fraction, fractionDigits_);
+        }
+        out += ']';
+    }
+
+    int fractionDigits_;
+    const std::chrono::time_zone* timeZone_;
+    std::int64_t timestamp_ = 0;
+    std::vector<Format> formats_;
+    std::vector<Arg> args_;
+    std::string message_;
+    std::string line_;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+
+    int fractionDigits = 0;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view argument(argv[i]);
+        if (argument == "--precision" && i + 1 < argc) {
+            std::string_view precision(argv[++i]);
+            fractionDigits = precision == "ms" ? 3 : precision == "us" ? 6 : precision == "ns" ? 9 : 0;
+        }
+        else {
+            files.emplace_back(argument);
+        }
+    }
+    if (files.empty()) {
+        std::println(stderr, "usage: vhlog-decode [--precision s|ms|us|ns] file.vhlb...");
+        return 2;
+    }
+
+    Decoder decoder(fractionDigits);
+    int result = 0;
+    for (const auto& fileName : files) {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file) {
+            std::println(stderr, "Failed to open {}", fileName);
+            result = 1;
+            continue;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        if (!decoder.decode(contents.str(), fileName)) {
+            result = 1;
+        }
+    }
+    return result;
+}